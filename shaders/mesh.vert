@@ -3,7 +3,7 @@
 layout (location = 0) in vec3 vertexPosition;
 layout (location = 1) in vec3 vertexNormal;
 layout (location = 2) in vec3 vertexColor;
-layout (location = 3) in vec3 vertexUV;
+layout (location = 3) in vec2 vertexUV;
 
 layout (location = 0) out vec3 outColor;
 layout (location = 1) out vec3 texCoord;
@@ -14,8 +14,11 @@ layout (set = 0, binding = 0) uniform CameraBuffer {
   mat4 viewXprojection;
 } camera;
 
+// see ObjectData in object_buffer.h
 struct Object {
   mat4 modelMatrix;
+  mat3 normalMatrix; // inverse transpose of modelMatrix
+  vec4 color; // multiplies the vertex color, w is unused
 };
 
 // std140 enforces how the memory is laid out and aligned
@@ -23,6 +26,11 @@ layout (std140, set = 1, binding = 0) readonly buffer ObjectBuffer {
   Object objects[];
 } objectData;
 
+// which object each instance is (see DrawList::instance_objects)
+layout (std430, set = 1, binding = 1) readonly buffer InstanceBuffer {
+  uint objectIndices[];
+} instanceData;
+
 layout (push_constant) uniform constants {
   float time;
   vec2 resolution;
@@ -47,7 +55,9 @@ mat4 rotate(vec3 axis, float angle) {
 }
 
 void main() {
-  mat4 modelMatrix = objectData.objects[gl_BaseInstance].modelMatrix;
+  // gl_InstanceIndex includes the batch's first instance
+  Object object = objectData.objects[instanceData.objectIndices[gl_InstanceIndex]];
+  mat4 modelMatrix = object.modelMatrix;
   mat4 transformMatrix = camera.viewXprojection * modelMatrix;
 
   gl_Position = transformMatrix * vec4(vertexPosition, 1.0f);
@@ -55,12 +65,12 @@ void main() {
   float s = sin(u_time);
   float c = cos(u_time);
   vec3 light_dir = vec3(s, 1.0f, c);
-  vec3 normal = inverse(transpose(mat3(modelMatrix))) * normalize(vertexNormal);
+  vec3 normal = object.normalMatrix * normalize(vertexNormal);
 
   float min_light = 0.2f;
   // float light_intensity = max(dot(light_dir, normal), min_light);
   float light_intensity = max(dot(vec3(1.0, 1.0, 1.0), normal), min_light);
 
-  outColor = vertexColor * light_intensity;
-  texCoord = vertexUV;
+  outColor = vertexColor * object.color.rgb * light_intensity;
+  texCoord = vec3(vertexUV, 0.0f);
 }
@@ -0,0 +1,78 @@
+#version 460
+
+// same as mesh.vert, for PackedVertex (see model.h): 16 bytes read as a
+// single uvec4 and unpacked here
+// positions come out between 0 and 1 across the model's bounds, the object's
+// model matrix has PackedModel::getDequantizeMatrix() folded into it
+layout (location = 0) in uvec4 packedVertex;
+
+layout (location = 0) out vec3 outColor;
+layout (location = 1) out vec3 texCoord;
+
+layout (set = 0, binding = 0) uniform CameraBuffer {
+  // mat4 view;
+  // mat4 projection;
+  mat4 viewXprojection;
+} camera;
+
+// see ObjectData in object_buffer.h
+struct Object {
+  mat4 modelMatrix;
+  mat3 normalMatrix; // inverse transpose of modelMatrix
+  vec4 color; // multiplies the vertex color, w is unused
+};
+
+// std140 enforces how the memory is laid out and aligned
+layout (std140, set = 1, binding = 0) readonly buffer ObjectBuffer {
+  Object objects[];
+} objectData;
+
+// which object each instance is (see DrawList::instance_objects)
+layout (std430, set = 1, binding = 1) readonly buffer InstanceBuffer {
+  uint objectIndices[];
+} instanceData;
+
+layout (push_constant) uniform constants {
+  float time;
+  vec2 resolution;
+} PushConstants;
+
+#define u_time PushConstants.time
+
+#define PI 3.14159265
+
+// the inverse of encodeOctahedral in model.cpp
+vec3 octahedralDecode(vec2 encoded) {
+  vec3 n = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+  float fold = max(-n.z, 0.0f);
+  n.x += n.x >= 0.0f ? -fold : fold;
+  n.y += n.y >= 0.0f ? -fold : fold;
+  return normalize(n);
+}
+
+void main() {
+  // x and y | z and the normal | color | uv
+  vec3 vertexPosition = vec3(unpackUnorm2x16(packedVertex.x), unpackUnorm2x16(packedVertex.y).x);
+  vec3 vertexNormal = octahedralDecode(unpackSnorm4x8(packedVertex.y).zw);
+  vec3 vertexColor = unpackUnorm4x8(packedVertex.z).rgb;
+  vec2 vertexUV = unpackHalf2x16(packedVertex.w);
+
+  // gl_InstanceIndex includes the batch's first instance
+  Object object = objectData.objects[instanceData.objectIndices[gl_InstanceIndex]];
+  mat4 modelMatrix = object.modelMatrix;
+  mat4 transformMatrix = camera.viewXprojection * modelMatrix;
+
+  gl_Position = transformMatrix * vec4(vertexPosition, 1.0f);
+
+  float s = sin(u_time);
+  float c = cos(u_time);
+  vec3 light_dir = vec3(s, 1.0f, c);
+  vec3 normal = object.normalMatrix * normalize(vertexNormal);
+
+  float min_light = 0.2f;
+  // float light_intensity = max(dot(light_dir, normal), min_light);
+  float light_intensity = max(dot(vec3(1.0, 1.0, 1.0), normal), min_light);
+
+  outColor = vertexColor * object.color.rgb * light_intensity;
+  texCoord = vec3(vertexUV, 0.0f);
+}
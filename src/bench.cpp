@@ -0,0 +1,650 @@
+#include <collision.h>
+#include <collision_simd.h>
+#include <dynamic_tree.h>
+#include <entity.h>
+#include <scene.h>
+#include <util.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// microbenchmarks for the collision and physics kernels, built as severin_bench
+// each kernel is run over a batch of count inputs and the time is divided back
+// out, since a single call is too quick to time on its own
+// results can be written out as JSON (-o) to compare one run against another
+
+
+static constexpr size_t kCounts[] = {10, 100, 1000, 10000, 100000};
+// fixed so every run sees the same inputs
+static constexpr uint32_t kSeed = 20240601;
+// batches get repeated until one sample takes at least this long
+static constexpr std::chrono::microseconds kMinSampleTime(2000);
+static constexpr size_t kBenchStaticEntities = 64;
+
+// results get added in here so the kernels can't be optimized away
+static volatile float sink = 0.0f;
+
+
+void printUsage() {
+	printf("usage: severin_bench [-s samples] [-t thread_count] [-k kernel_filter] [-o results.json]\n");
+	exit(0);
+}
+
+struct BenchOptions {
+	int sample_count = 20;
+	int thread_count = 1; // for Scene::applyPhysics, 0 means one per core
+	std::string kernel_filter; // only kernels with this in their name, empty runs everything
+	std::string output_file; // empty if not writing JSON
+};
+
+BenchOptions parseArguments(int argc, char* argv[]) {
+	BenchOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = std::string(argv[i]);
+
+		if (i + 1 >= argc) {
+			printUsage();
+		}
+
+		i += 1;
+
+		if (arg == "-s") {
+			options.sample_count = std::max(2, atoi(argv[i]));
+		} else if (arg == "-t") {
+			options.thread_count = atoi(argv[i]);
+		} else if (arg == "-k") {
+			options.kernel_filter = argv[i];
+		} else if (arg == "-o") {
+			options.output_file = argv[i];
+		} else {
+			printUsage();
+		}
+	}
+
+	return options;
+}
+
+
+struct BenchResult {
+	std::string kernel;
+	size_t count = 0;
+	int sample_count = 0;
+	size_t batches_per_sample = 0;
+	// over the samples, in ns per op
+	double mean = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+	double variance = 0.0;
+	double ops_per_second = 0.0; // from the mean
+};
+
+// runs the kernel once over its whole batch
+using BatchFunction = std::function<void()>;
+// puts the inputs back the way they were before a batch, and isn't timed
+// (for kernels that change their own inputs, like applyPhysics)
+using ResetFunction = std::function<void()>;
+
+
+static const double timeBatches(const size_t batch_count, const BatchFunction& batch, const ResetFunction& reset) {
+	using namespace std::chrono;
+
+	if (!reset) {
+		steady_clock::time_point start = steady_clock::now();
+
+		for (size_t i = 0; i < batch_count; i++) {
+			batch();
+		}
+
+		return duration<double, std::nano>(steady_clock::now() - start).count();
+	}
+
+	double total_ns = 0.0;
+
+	for (size_t i = 0; i < batch_count; i++) {
+		reset();
+
+		steady_clock::time_point start = steady_clock::now();
+		batch();
+		total_ns += duration<double, std::nano>(steady_clock::now() - start).count();
+	}
+
+	return total_ns;
+}
+
+static const BenchResult measure(
+		const std::string& kernel,
+		const size_t count,
+		const int sample_count,
+		const BatchFunction& batch,
+		const ResetFunction& reset = nullptr) {
+	BenchResult result;
+	result.kernel = kernel;
+	result.count = count;
+	result.sample_count = sample_count;
+
+	// warm up, and work out how many batches make a sample long enough to time
+	timeBatches(1, batch, reset);
+	double batch_ns = std::max(timeBatches(1, batch, reset), 1.0);
+	double min_sample_ns = std::chrono::duration<double, std::nano>(kMinSampleTime).count();
+	result.batches_per_sample = static_cast<size_t>(std::max(1.0, std::ceil(min_sample_ns / batch_ns)));
+
+	std::vector<double> ns_per_op(sample_count);
+	double ops_per_sample = static_cast<double>(result.batches_per_sample * count);
+
+	for (int i = 0; i < sample_count; i++) {
+		ns_per_op[i] = timeBatches(result.batches_per_sample, batch, reset) / ops_per_sample;
+	}
+
+	result.min = *std::min_element(ns_per_op.begin(), ns_per_op.end());
+	result.max = *std::max_element(ns_per_op.begin(), ns_per_op.end());
+
+	for (double sample : ns_per_op) {
+		result.mean += sample;
+	}
+
+	result.mean /= sample_count;
+
+	for (double sample : ns_per_op) {
+		result.variance += (sample - result.mean) * (sample - result.mean);
+	}
+
+	result.variance /= sample_count - 1;
+	result.ops_per_second = result.mean > 0.0 ? 1e9 / result.mean : 0.0;
+
+	printf(
+			"%-28s %7zu  %10.2f ns/op  +/- %5.1f%%  min %10.2f  %14.0f ops/s\n",
+			kernel.c_str(),
+			count,
+			result.mean,
+			result.mean > 0.0 ? 100.0 * std::sqrt(result.variance) / result.mean : 0.0,
+			result.min,
+			result.ops_per_second);
+
+	return result;
+}
+
+
+struct BenchData {
+	std::mt19937 rng{kSeed};
+
+	const float randomFloat(const float lower_bound, const float upper_bound) {
+		return std::uniform_real_distribution<float>(lower_bound, upper_bound)(rng);
+	}
+
+	const glm::vec3 randomVec3(const float lower_bound, const float upper_bound) {
+		float x = randomFloat(lower_bound, upper_bound);
+		float y = randomFloat(lower_bound, upper_bound);
+		float z = randomFloat(lower_bound, upper_bound);
+
+		return glm::vec3(x, y, z);
+	}
+
+	const AABB randomBox() {
+		glm::vec3 center = randomVec3(-50.0f, 50.0f);
+		glm::vec3 half_extents = randomVec3(0.5f, 5.0f);
+
+		return AABB{center - half_extents, center + half_extents};
+	}
+
+	// starts somewhere near the box, and roughly half of them hit it
+	const Ray rayTowards(const AABB& box) {
+		glm::vec3 center = (box.min_pos + box.max_pos) * 0.5f;
+		glm::vec3 origin = center + randomVec3(-20.0f, 20.0f);
+		glm::vec3 target = center + randomVec3(-6.0f, 6.0f);
+
+		return Ray{origin, util::safeNormalize(target - origin)};
+	}
+
+	// a sphere near the box, moving about a radius, overlapping it about half
+	// the time
+	const Sphere sphereNear(const AABB& box, glm::vec3& center_end) {
+		float radius = randomFloat(0.25f, 1.0f);
+		glm::vec3 half_extents = (box.max_pos - box.min_pos) * 0.5f;
+		glm::vec3 center = (box.min_pos + box.max_pos) * 0.5f;
+		glm::vec3 offset = randomVec3(-1.0f, 1.0f) * (half_extents + glm::vec3(radius * 2.0f));
+		center_end = center + offset + randomVec3(-radius, radius);
+
+		return Sphere{center + offset, radius};
+	}
+};
+
+
+static void benchRayAABB(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	BenchData data;
+	std::vector<AABB> boxes(count);
+	std::vector<Ray> rays(count);
+
+	for (size_t i = 0; i < count; i++) {
+		boxes[i] = data.randomBox();
+		rays[i] = data.rayTowards(boxes[i]);
+	}
+
+	results.push_back(measure("rayAABB", count, options.sample_count, [&]() {
+		float total = 0.0f;
+
+		for (size_t i = 0; i < count; i++) {
+			float t;
+			glm::vec3 collision_point;
+
+			if (rayAABB(rays[i], boxes[i], t, collision_point)) {
+				total += t;
+			}
+		}
+
+		sink = sink + total;
+	}));
+}
+
+// culling count boxes against the default camera, one at a time and batched
+// (with whatever instruction set the CPU has)
+static void benchFrustumCull(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	BenchData data;
+	std::vector<AABB> boxes(count);
+	AABBBatch batch;
+	std::vector<uint32_t> visible_indices(count);
+
+	for (size_t i = 0; i < count; i++) {
+		boxes[i] = data.randomBox();
+		batch.add(boxes[i]);
+	}
+
+	Frustum frustum = Camera(16.0f / 9.0f).getFrustum();
+
+	results.push_back(measure("frustumOverlapsAABB", count, options.sample_count, [&]() {
+		uint32_t total = 0;
+
+		for (size_t i = 0; i < count; i++) {
+			total += frustumOverlapsAABB(frustum, boxes[i]);
+		}
+
+		sink = sink + total;
+	}));
+
+	results.push_back(measure("simd::frustumVsAABBs", count, options.sample_count, [&]() {
+		sink = sink + simd::frustumVsAABBs(frustum, batch, visible_indices.data());
+	}));
+}
+
+static void benchSphereVsAABB(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	BenchData data;
+	std::vector<AABB> boxes(count);
+	std::vector<Sphere> spheres(count);
+	std::vector<glm::vec3> center_ends(count);
+
+	for (size_t i = 0; i < count; i++) {
+		boxes[i] = data.randomBox();
+		spheres[i] = data.sphereNear(boxes[i], center_ends[i]);
+	}
+
+	results.push_back(measure("Collision::sphereVsAABB", count, options.sample_count, [&]() {
+		float total = 0.0f;
+
+		for (size_t i = 0; i < count; i++) {
+			glm::vec3 collision_point;
+
+			if (Collision::sphereVsAABB(spheres[i], center_ends[i], boxes[i], collision_point)) {
+				total += collision_point.x;
+			}
+		}
+
+		sink = sink + total;
+	}));
+}
+
+static void benchClosestPointToAABB(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	BenchData data;
+	std::vector<AABB> boxes(count);
+	std::vector<glm::vec3> points(count);
+
+	for (size_t i = 0; i < count; i++) {
+		boxes[i] = data.randomBox();
+		points[i] = (boxes[i].min_pos + boxes[i].max_pos) * 0.5f + data.randomVec3(-8.0f, 8.0f);
+	}
+
+	results.push_back(measure("closestPointToAABB", count, options.sample_count, [&]() {
+		glm::vec3 total(0.0f);
+
+		for (size_t i = 0; i < count; i++) {
+			total += closestPointToAABB(points[i], boxes[i]);
+		}
+
+		sink = sink + total.x + total.y + total.z;
+	}));
+}
+
+// what DynamicEntity::collideWith became once dynamic entities were split into
+// components
+static void benchCollideWith(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	BenchData data;
+	std::vector<Entity> entities;
+	std::vector<SphereCollider> colliders(count);
+	std::vector<glm::vec3> center_ends(count);
+	entities.reserve(count);
+
+	for (size_t i = 0; i < count; i++) {
+		AABB box = data.randomBox();
+		Entity& entity = entities.emplace_back(0, 0, (box.min_pos + box.max_pos) * 0.5f, util::kNoRotation, 1.0f);
+		entity.collision.type = Collision::Type::aabb;
+		entity.collision.shape.box = box;
+
+		colliders[i].sphere = data.sphereNear(box, center_ends[i]);
+	}
+
+	results.push_back(measure("SphereCollider::collideWith", count, options.sample_count, [&]() {
+		float total = 0.0f;
+
+		for (size_t i = 0; i < count; i++) {
+			SweepHit hit;
+
+			if (colliders[i].collideWith(entities[i], center_ends[i], hit)) {
+				total += hit.t;
+			}
+		}
+
+		sink = sink + total;
+	}));
+}
+
+// what DynamicEntity::move became, see benchCollideWith
+static void benchMove(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	constexpr glm::vec3 gravity_acceleration{0.0f, -9.8f, 0.0f};
+
+	BenchData data;
+	std::vector<RigidBody> bodies(count);
+
+	for (RigidBody& body : bodies) {
+		body.position = data.randomVec3(-50.0f, 50.0f);
+		body.velocity = data.randomVec3(-5.0f, 5.0f);
+		body.mass = data.randomFloat(1.0f, 100.0f);
+	}
+
+	// positions just keep drifting, which doesn't matter for timing
+	results.push_back(measure("RigidBody::move", count, options.sample_count, [&]() {
+		for (RigidBody& body : bodies) {
+			body.applyAcceleration(gravity_acceleration);
+			body.move(Scene::kTickSec);
+		}
+
+		sink = sink + bodies[0].position.y;
+	}));
+}
+
+// count small boxes drifting around, each moving a little every batch, so
+// some of them leave their fat boxes and get reinserted
+static void benchDynamicTree(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	BenchData data;
+	DynamicTree tree;
+	std::vector<AABB> boxes(count);
+	std::vector<glm::vec3> velocities(count);
+	std::vector<DynamicTreeProxy> proxies(count);
+	std::vector<AABB> query_boxes(count);
+	float half_width = std::max(5.0f, std::cbrt(static_cast<float>(count)) * 4.0f);
+
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 center = data.randomVec3(-half_width, half_width);
+		boxes[i] = AABB{center - glm::vec3(0.5f), center + glm::vec3(0.5f)};
+		velocities[i] = data.randomVec3(-5.0f, 5.0f) * Scene::kTickSec;
+		proxies[i] = tree.createProxy(boxes[i], static_cast<uint32_t>(i));
+
+		glm::vec3 query_center = data.randomVec3(-half_width, half_width);
+		query_boxes[i] = AABB{query_center - glm::vec3(2.0f), query_center + glm::vec3(2.0f)};
+	}
+
+	results.push_back(measure("DynamicTree::query", count, options.sample_count, [&]() {
+		uint32_t total = 0;
+
+		for (const AABB& query_box : query_boxes) {
+			tree.query(query_box, [&](const uint32_t user_data) {
+				total += user_data;
+				return true;
+			});
+		}
+
+		sink = sink + total;
+	}));
+
+	results.push_back(measure("DynamicTree::moveProxy", count, options.sample_count, [&]() {
+		for (size_t i = 0; i < count; i++) {
+			boxes[i].min_pos += velocities[i];
+			boxes[i].max_pos += velocities[i];
+			tree.moveProxy(proxies[i], boxes[i], velocities[i]);
+		}
+	}));
+}
+
+// count balls over a floor scattered with boxes, at the same density no
+// matter how many there are
+// returns the half width of the floor
+static const float fillBenchScene(Scene& scene, const size_t count, BenchData& data) {
+	float half_width = std::max(5.0f, std::cbrt(static_cast<float>(count)) * 2.0f);
+
+	StaticEntityID floor_id = scene.addStaticEntity(0, 0, glm::vec3(0.0f), util::kNoRotation, 1.0f);
+	Entity& floor = scene.getStaticEntity(floor_id);
+	floor.collision.type = Collision::Type::aabb;
+	floor.collision.shape.box = AABB{glm::vec3(-half_width, -1.0f, -half_width), glm::vec3(half_width, 0.0f, half_width)};
+
+	for (size_t i = 1; i < kBenchStaticEntities; i++) {
+		glm::vec3 position(data.randomFloat(-half_width, half_width), 0.5f, data.randomFloat(-half_width, half_width));
+		glm::vec3 half_extents = data.randomVec3(0.5f, 2.0f);
+		StaticEntityID id = scene.addStaticEntity(0, 0, position, util::kNoRotation, 1.0f);
+		Entity& ent = scene.getStaticEntity(id);
+		ent.collision.type = Collision::Type::aabb;
+		ent.collision.shape.box = AABB{position - half_extents, position + half_extents};
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 position(
+				data.randomFloat(-half_width, half_width),
+				data.randomFloat(0.5f, half_width),
+				data.randomFloat(-half_width, half_width));
+		DynamicEntityID id = scene.addDynamicEntity(0, 0, position, util::kNoRotation, 1.0f, 1.0f);
+		DynamicEntityIndex index = scene.getDynamicEntityIndex(id);
+		scene.dynamic_entities.initCollision(index, 0.5f);
+		scene.dynamic_entities.bodies[index].velocity = data.randomVec3(-3.0f, 3.0f);
+	}
+
+	scene.buildStaticCollision();
+
+	return half_width;
+}
+
+// a full physics tick for count balls (see fillBenchScene)
+// each batch starts from the same state, so the balls don't all fall asleep
+// part way through the run
+static void benchApplyPhysics(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	size_t max_dynamic_entities = Scene::kMaxEntities - ProjectileSystem::kMaxProjectiles - kBenchStaticEntities;
+
+	if (count > max_dynamic_entities) {
+		util::log("skipping Scene::applyPhysics with %zu entities, a scene only holds %zu", count, max_dynamic_entities);
+		return;
+	}
+
+	BenchData data;
+	Scene scene(Camera(1.0f), kBenchStaticEntities, count);
+	scene.startWorkers(options.thread_count);
+	fillBenchScene(scene, count, data);
+
+	const std::vector<RigidBody> start_bodies = scene.dynamic_entities.bodies;
+	const std::vector<SphereCollider> start_colliders = scene.dynamic_entities.colliders;
+	const std::vector<SleepState> start_sleep_states = scene.dynamic_entities.sleep_states;
+
+	ResetFunction reset = [&]() {
+		scene.dynamic_entities.bodies = start_bodies;
+		scene.dynamic_entities.colliders = start_colliders;
+		scene.dynamic_entities.sleep_states = start_sleep_states;
+	};
+
+	results.push_back(measure("Scene::applyPhysics", count, options.sample_count, [&]() {
+		scene.applyPhysics(Scene::kTickSec);
+	}, reset));
+}
+
+// count blast radius sized sphere queries against a scene with a couple
+// thousand balls in it, one at a time and then all in one batch
+static void benchOverlap(const size_t count, const BenchOptions& options, std::vector<BenchResult>& results) {
+	constexpr size_t kSceneEntityCount = 2000;
+	constexpr uint32_t kMaxHitsPerQuery = 256;
+
+	BenchData data;
+	Scene scene(Camera(1.0f), kBenchStaticEntities, kSceneEntityCount);
+	float half_width = fillBenchScene(scene, kSceneEntityCount, data);
+	scene.applyPhysics(Scene::kTickSec); // fills in the dynamic tree
+
+	std::vector<OverlapQuery> queries(count);
+	std::vector<OverlapHit> hit_storage(count * kMaxHitsPerQuery);
+	std::vector<OverlapResults> overlap_results(count);
+
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 center(
+				data.randomFloat(-half_width, half_width),
+				data.randomFloat(0.0f, half_width),
+				data.randomFloat(-half_width, half_width));
+		queries[i] = OverlapQuery::fromSphere(center, data.randomFloat(1.0f, 4.0f));
+		overlap_results[i] = OverlapResults(&hit_storage[i * kMaxHitsPerQuery], kMaxHitsPerQuery);
+	}
+
+	results.push_back(measure("Scene::overlap", count, options.sample_count, [&]() {
+		uint32_t total = 0;
+
+		for (size_t i = 0; i < count; i++) {
+			scene.overlap(queries[i], overlap_results[i]);
+			total += overlap_results[i].count;
+		}
+
+		sink = sink + total;
+	}));
+
+	results.push_back(measure("Scene::overlapBatch", count, options.sample_count, [&]() {
+		scene.overlapBatch(queries.data(), count, overlap_results.data());
+		sink = sink + overlap_results[0].count;
+	}));
+
+	// the same again, but with every chunk of queries bunched up around one spot
+	// (e.g. everything an explosion or a squad is checking), which is where
+	// walking the trees once per chunk pays off
+	constexpr float kClusterSpread = 2.0f;
+
+	for (size_t i = 0; i < count; i += kOverlapChunkSize) {
+		glm::vec3 cluster_center(
+				data.randomFloat(-half_width, half_width),
+				data.randomFloat(0.0f, half_width),
+				data.randomFloat(-half_width, half_width));
+
+		for (size_t j = i; j < std::min(i + kOverlapChunkSize, count); j++) {
+			glm::vec3 offset(
+					data.randomFloat(-kClusterSpread, kClusterSpread),
+					data.randomFloat(-kClusterSpread, kClusterSpread),
+					data.randomFloat(-kClusterSpread, kClusterSpread));
+			queries[j] = OverlapQuery::fromSphere(cluster_center + offset, data.randomFloat(1.0f, 4.0f));
+		}
+	}
+
+	results.push_back(measure("Scene::overlap clustered", count, options.sample_count, [&]() {
+		uint32_t total = 0;
+
+		for (size_t i = 0; i < count; i++) {
+			scene.overlap(queries[i], overlap_results[i]);
+			total += overlap_results[i].count;
+		}
+
+		sink = sink + total;
+	}));
+
+	results.push_back(measure("Scene::overlapBatch clustered", count, options.sample_count, [&]() {
+		scene.overlapBatch(queries.data(), count, overlap_results.data());
+		sink = sink + overlap_results[0].count;
+	}));
+}
+
+
+static void writeJSON(const std::string& path, const BenchOptions& options, const std::vector<BenchResult>& results) {
+	FILE* file = fopen(path.c_str(), "w");
+
+	if (!file) {
+		util::logError("couldn't open %s for writing", path.c_str());
+		return;
+	}
+
+	// one result per line, so two runs diff nicely too
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"seed\": %u,\n", kSeed);
+	fprintf(file, "\t\"thread_count\": %d,\n", options.thread_count);
+	fprintf(file, "\t\"sample_count\": %d,\n", options.sample_count);
+	fprintf(file, "\t\"results\": [\n");
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult& result = results[i];
+
+		fprintf(
+				file,
+				"\t\t{\"kernel\": \"%s\", \"count\": %zu, \"batches_per_sample\": %zu, \"ns_per_op\": %.4f, \"min_ns_per_op\": %.4f, \"max_ns_per_op\": %.4f, \"variance\": %.6f, \"ops_per_second\": %.1f}%s\n",
+				result.kernel.c_str(),
+				result.count,
+				result.batches_per_sample,
+				result.mean,
+				result.min,
+				result.max,
+				result.variance,
+				result.ops_per_second,
+				i + 1 < results.size() ? "," : "");
+	}
+
+	fprintf(file, "\t]\n");
+	fprintf(file, "}\n");
+	fclose(file);
+
+	util::log("wrote %zu results to %s", results.size(), path.c_str());
+}
+
+
+int main(int argc, char* argv[]) {
+	util::init();
+
+	BenchOptions options = parseArguments(argc, argv);
+
+	using BenchFunction = void(*)(const size_t, const BenchOptions&, std::vector<BenchResult>&);
+
+	struct Bench {
+		const char* kernel;
+		BenchFunction function;
+	};
+
+	const Bench benches[] = {
+		{"rayAABB", benchRayAABB},
+		{"frustumCull", benchFrustumCull},
+		{"Collision::sphereVsAABB", benchSphereVsAABB},
+		{"closestPointToAABB", benchClosestPointToAABB},
+		{"SphereCollider::collideWith", benchCollideWith},
+		{"RigidBody::move", benchMove},
+		{"DynamicTree", benchDynamicTree},
+		{"Scene::applyPhysics", benchApplyPhysics},
+		{"Scene::overlap", benchOverlap},
+	};
+
+	std::vector<BenchResult> results;
+
+	for (const Bench& bench : benches) {
+		if (!options.kernel_filter.empty() && std::string(bench.kernel).find(options.kernel_filter) == std::string::npos) {
+			continue;
+		}
+
+		for (size_t count : kCounts) {
+			bench.function(count, options, results);
+		}
+	}
+
+	if (!options.output_file.empty()) {
+		writeJSON(options.output_file, options, results);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+#include <broadphase.h>
+
+#include <util.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+void PhysicsStats::log() const {
+	util::log(
+			"physics: %u sleeping, %u substeps; static %u candidate pairs, %u contacts; dynamic %u candidate pairs, %u contacts, %u tree reinserts; %u projectiles, %u hits",
+			sleeping_entities,
+			substeps,
+			candidate_pairs,
+			contacts,
+			dynamic_candidate_pairs,
+			dynamic_contacts,
+			dynamic_tree_reinserts,
+			projectiles,
+			projectile_hits);
+}
+
+
+struct CellRange {
+	glm::ivec3 min_cell;
+	glm::ivec3 max_cell;
+
+	const int cellCount() const {
+		glm::ivec3 dims = max_cell - min_cell + 1;
+		return dims.x * dims.y * dims.z;
+	}
+};
+
+static CellRange cellRangeForBounds(const AABB& bounds, const float cell_size) {
+	CellRange range;
+	range.min_cell = glm::ivec3(glm::floor(bounds.min_pos / cell_size));
+	range.max_cell = glm::ivec3(glm::floor(bounds.max_pos / cell_size));
+	return range;
+}
+
+// real time collision detection pg. 288
+static uint32_t hashCell(const int x, const int y, const int z) {
+	constexpr uint32_t h1 = 0x8da6b343;
+	constexpr uint32_t h2 = 0xd8163841;
+	constexpr uint32_t h3 = 0xcb1ab31f;
+
+	return h1 * static_cast<uint32_t>(x) + h2 * static_cast<uint32_t>(y) + h3 * static_cast<uint32_t>(z);
+}
+
+
+void StaticGrid::build(const std::vector<Entity>& static_entities, float new_cell_size) {
+	struct BucketEntry {
+		uint32_t bucket;
+		StaticEntityIndex entity_id;
+	};
+
+	cell_size = new_cell_size;
+	entity_count = static_entities.size();
+	large_entity_ids.clear();
+
+	std::vector<BucketEntry> entries;
+
+	// first pass: figure out how many cell entries we need so the table can be
+	// sized to keep buckets sparse
+	size_t entry_count = 0;
+
+	for (const Entity& ent : static_entities) {
+		if (ent.collision.type == Collision::Type::none) {
+			continue;
+		}
+
+		CellRange range = cellRangeForBounds(ent.collision.getBounds(), cell_size);
+		int cell_count = range.cellCount();
+
+		if (cell_count <= kMaxCellsPerEntity) {
+			entry_count += cell_count;
+		}
+	}
+
+	uint32_t bucket_count = 1;
+	while (bucket_count < entry_count * 2) {
+		bucket_count <<= 1;
+	}
+	bucket_mask = bucket_count - 1;
+
+	entries.reserve(entry_count);
+
+	for (size_t i = 0; i < static_entities.size(); i++) {
+		const Entity& ent = static_entities[i];
+		StaticEntityIndex id = static_cast<StaticEntityIndex>(i);
+
+		if (ent.collision.type == Collision::Type::none) {
+			continue;
+		}
+
+		CellRange range = cellRangeForBounds(ent.collision.getBounds(), cell_size);
+
+		if (range.cellCount() > kMaxCellsPerEntity) {
+			large_entity_ids.push_back(id);
+			continue;
+		}
+
+		for (int x = range.min_cell.x; x <= range.max_cell.x; x++) {
+			for (int y = range.min_cell.y; y <= range.max_cell.y; y++) {
+				for (int z = range.min_cell.z; z <= range.max_cell.z; z++) {
+					entries.push_back({hashCell(x, y, z) & bucket_mask, id});
+				}
+			}
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const BucketEntry& a, const BucketEntry& b) {
+		return a.bucket < b.bucket || (a.bucket == b.bucket && a.entity_id < b.entity_id);
+	});
+
+	// counting pass to turn the sorted entries into bucket ranges
+	bucket_starts.assign(bucket_count + 1, 0);
+	bucket_entity_ids.resize(entries.size());
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		bucket_starts[entries[i].bucket + 1]++;
+		bucket_entity_ids[i] = entries[i].entity_id;
+	}
+
+	for (uint32_t bucket = 0; bucket < bucket_count; bucket++) {
+		bucket_starts[bucket + 1] += bucket_starts[bucket];
+	}
+
+	util::log(
+			"built static grid: %zu entities, %zu cell entries, %zu large entities, %u buckets",
+			entity_count,
+			entries.size(),
+			large_entity_ids.size(),
+			bucket_count);
+}
+
+
+void StaticGrid::query(
+		const AABB& bounds,
+		QueryScratch& scratch,
+		std::vector<StaticEntityIndex>& results) const {
+	results.clear();
+
+	if (!isBuilt()) {
+		return;
+	}
+
+	if (scratch.stamps.size() != entity_count) {
+		scratch.stamps.assign(entity_count, 0);
+		scratch.current_stamp = 0;
+	}
+
+	scratch.current_stamp++;
+
+	if (scratch.current_stamp == 0) {
+		// wrapped around, so old stamps could look current
+		std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+		scratch.current_stamp = 1;
+	}
+
+	auto add_candidate = [&](StaticEntityIndex id) {
+		if (scratch.stamps[id] != scratch.current_stamp) {
+			scratch.stamps[id] = scratch.current_stamp;
+			results.push_back(id);
+		}
+	};
+
+	for (StaticEntityIndex id : large_entity_ids) {
+		add_candidate(id);
+	}
+
+	CellRange range = cellRangeForBounds(bounds, cell_size);
+
+	if (range.cellCount() > static_cast<int>(bucket_mask) + 1) {
+		// the query covers more cells than there are buckets, so just take them all
+		for (StaticEntityIndex id : bucket_entity_ids) {
+			add_candidate(id);
+		}
+	} else {
+		for (int x = range.min_cell.x; x <= range.max_cell.x; x++) {
+			for (int y = range.min_cell.y; y <= range.max_cell.y; y++) {
+				for (int z = range.min_cell.z; z <= range.max_cell.z; z++) {
+					uint32_t bucket = hashCell(x, y, z) & bucket_mask;
+
+					for (uint32_t i = bucket_starts[bucket]; i < bucket_starts[bucket + 1]; i++) {
+						add_candidate(bucket_entity_ids[i]);
+					}
+				}
+			}
+		}
+	}
+
+	// keep collision resolution order identical to a brute force pass
+	std::sort(results.begin(), results.end());
+}
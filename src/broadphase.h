@@ -0,0 +1,94 @@
+#pragma once
+
+#include <collision.h>
+#include <collision_simd.h>
+#include <entity.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// running totals for a single physics step, so we can see how much work the
+// broadphase is saving us
+struct PhysicsStats {
+	uint32_t candidate_pairs = 0; // dynamic vs static pairs handed to narrowphase
+	uint32_t contacts = 0; // dynamic vs static pairs that actually collided
+	uint32_t dynamic_candidate_pairs = 0; // dynamic vs dynamic
+	uint32_t dynamic_contacts = 0;
+	uint32_t dynamic_tree_reinserts = 0; // entities that left their fat box in the dynamic tree
+	uint32_t substeps = 0; // across all awake dynamic entities, at least one each
+	uint32_t sleeping_entities = 0;
+	uint32_t projectiles = 0; // alive at the end of the step
+	uint32_t projectile_hits = 0;
+
+	void reset() {
+		*this = PhysicsStats{};
+	}
+
+	void add(const PhysicsStats& other) {
+		candidate_pairs += other.candidate_pairs;
+		contacts += other.contacts;
+		dynamic_candidate_pairs += other.dynamic_candidate_pairs;
+		dynamic_contacts += other.dynamic_contacts;
+		dynamic_tree_reinserts += other.dynamic_tree_reinserts;
+		substeps += other.substeps;
+		sleeping_entities += other.sleeping_entities;
+		projectiles += other.projectiles;
+		projectile_hits += other.projectile_hits;
+	}
+
+	void log() const;
+};
+
+
+// uniform grid over the static entities, stored as a spatial hash
+// this is built once when the level loads: every static AABB is inserted into
+// each cell it touches, then all the (bucket, entity) pairs are sorted so each
+// bucket is a contiguous run of entity IDs
+struct StaticGrid {
+	static constexpr float kDefaultCellSize = 4.0f; // meters
+	// boxes that would fill more cells than this (floors, walls) go in a list
+	// that every query checks, instead of bloating the table
+	static constexpr int kMaxCellsPerEntity = 64;
+
+	// each query needs its own scratch space to de-duplicate entities that span
+	// multiple cells
+	struct QueryScratch {
+		std::vector<uint32_t> stamps; // last query that saw each static entity
+		uint32_t current_stamp = 0;
+	};
+
+	float cell_size = kDefaultCellSize;
+	uint32_t bucket_mask = 0;
+	std::vector<uint32_t> bucket_starts; // bucket i is [bucket_starts[i], bucket_starts[i + 1])
+	std::vector<StaticEntityIndex> bucket_entity_ids;
+	std::vector<StaticEntityIndex> large_entity_ids;
+	size_t entity_count = 0; // static entity count at build time
+
+	void build(const std::vector<Entity>& static_entities, float new_cell_size = kDefaultCellSize);
+
+	// collect every static entity that might overlap bounds, in ascending ID order
+	void query(
+			const AABB& bounds,
+			QueryScratch& scratch,
+			std::vector<StaticEntityIndex>& results) const;
+
+	const bool isBuilt() const {
+		return !bucket_starts.empty();
+	}
+};
+
+
+// scratch space for one thread's worth of collision queries
+struct CollisionScratch {
+	StaticGrid::QueryScratch grid;
+	std::vector<StaticEntityIndex> candidates;
+
+	// candidate boxes gathered for the batched narrowphase kernels
+	AABBBatch candidate_boxes;
+	std::vector<StaticEntityIndex> candidate_box_ids;
+	std::vector<uint32_t> hit_indices;
+	std::vector<glm::vec3> closest_points;
+};
@@ -0,0 +1,630 @@
+#include <bvh.h>
+
+#include <triangle_mesh.h>
+#include <util.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+static AABB emptyBounds() {
+	constexpr float kMax = std::numeric_limits<float>::max();
+	return AABB{glm::vec3(kMax), glm::vec3(-kMax)};
+}
+
+static void growBounds(AABB& bounds, const AABB& other) {
+	bounds.min_pos = glm::min(bounds.min_pos, other.min_pos);
+	bounds.max_pos = glm::max(bounds.max_pos, other.max_pos);
+}
+
+static float surfaceArea(const AABB& bounds) {
+	glm::vec3 extent = glm::max(bounds.max_pos - bounds.min_pos, glm::vec3(0.0f));
+	return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+
+// returns the index of the new node
+// the first child of an interior node is always built right after it, which
+// gives us the depth first layout for free
+static uint32_t buildNode(
+		std::vector<BVHBuildPrimitive>& primitives,
+		const uint32_t start,
+		const uint32_t end,
+		const int depth,
+		const int max_leaf_size,
+		std::vector<BVHNode>& nodes) {
+	uint32_t node_index = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+
+	AABB bounds = emptyBounds();
+	AABB centroid_bounds = emptyBounds();
+
+	for (uint32_t i = start; i < end; i++) {
+		growBounds(bounds, primitives[i].box);
+		growBounds(centroid_bounds, AABB{primitives[i].centroid, primitives[i].centroid});
+	}
+
+	nodes[node_index].min_pos = bounds.min_pos;
+	nodes[node_index].max_pos = bounds.max_pos;
+
+	uint32_t count = end - start;
+
+	auto make_leaf = [&]() {
+		nodes[node_index].offset = start;
+		nodes[node_index].primitive_count = static_cast<uint16_t>(count);
+		nodes[node_index].split_axis = 0;
+		return node_index;
+	};
+
+	if (count <= max_leaf_size || depth >= kBVHMaxDepth - 1) {
+		return make_leaf();
+	}
+
+	// split along the axis with the most centroid spread
+	glm::vec3 centroid_extent = centroid_bounds.max_pos - centroid_bounds.min_pos;
+	int axis = 0;
+	if (centroid_extent.y > centroid_extent[axis]) {
+		axis = 1;
+	}
+	if (centroid_extent.z > centroid_extent[axis]) {
+		axis = 2;
+	}
+
+	if (centroid_extent[axis] < util::kEpsilon) {
+		// everything is stacked on top of each other, no split will help
+		return make_leaf();
+	}
+
+	// bin the centroids and evaluate the SAH at each bin boundary
+	struct Bin {
+		AABB bounds = emptyBounds();
+		uint32_t count = 0;
+	};
+
+	constexpr int kBinCount = kBVHSAHBinCount;
+	Bin bins[kBinCount];
+	float bin_scale = kBinCount / centroid_extent[axis];
+
+	auto bin_index = [&](const BVHBuildPrimitive& prim) {
+		int index = static_cast<int>((prim.centroid[axis] - centroid_bounds.min_pos[axis]) * bin_scale);
+		return std::min(index, kBinCount - 1);
+	};
+
+	for (uint32_t i = start; i < end; i++) {
+		Bin& bin = bins[bin_index(primitives[i])];
+		bin.count++;
+		growBounds(bin.bounds, primitives[i].box);
+	}
+
+	// right to left sweep first, so the left to right sweep can finish the cost
+	float right_areas[kBinCount - 1];
+	uint32_t right_counts[kBinCount - 1];
+	AABB right_bounds = emptyBounds();
+	uint32_t right_count = 0;
+
+	for (int i = kBinCount - 1; i > 0; i--) {
+		growBounds(right_bounds, bins[i].bounds);
+		right_count += bins[i].count;
+		right_areas[i - 1] = surfaceArea(right_bounds);
+		right_counts[i - 1] = right_count;
+	}
+
+	int best_split = -1;
+	float best_cost = std::numeric_limits<float>::max();
+	AABB left_bounds = emptyBounds();
+	uint32_t left_count = 0;
+
+	for (int i = 0; i < kBinCount - 1; i++) {
+		growBounds(left_bounds, bins[i].bounds);
+		left_count += bins[i].count;
+
+		if (left_count == 0 || right_counts[i] == 0) {
+			continue;
+		}
+
+		float cost = surfaceArea(left_bounds) * left_count + right_areas[i] * right_counts[i];
+
+		if (cost < best_cost) {
+			best_cost = cost;
+			best_split = i;
+		}
+	}
+
+	// traversal is assumed to cost about the same as one box test
+	float leaf_cost = static_cast<float>(count);
+	float split_cost = 1.0f + best_cost / std::max(surfaceArea(bounds), util::kEpsilon);
+
+	if (best_split < 0 || (split_cost >= leaf_cost && count <= 4 * max_leaf_size)) {
+		return make_leaf();
+	}
+
+	auto split_begin = primitives.begin() + start;
+	auto split_end = primitives.begin() + end;
+	auto middle = std::partition(split_begin, split_end, [&](const BVHBuildPrimitive& prim) {
+		return bin_index(prim) <= best_split;
+	});
+
+	uint32_t mid = static_cast<uint32_t>(middle - primitives.begin());
+
+	if (mid == start || mid == end) {
+		// shouldn't happen since empty sides are skipped, but split evenly just in case
+		mid = start + count / 2;
+		std::nth_element(split_begin, primitives.begin() + mid, split_end,
+				[axis](const BVHBuildPrimitive& a, const BVHBuildPrimitive& b) {
+					return a.centroid[axis] < b.centroid[axis];
+				});
+	}
+
+	buildNode(primitives, start, mid, depth + 1, max_leaf_size, nodes);
+	uint32_t second_child = buildNode(primitives, mid, end, depth + 1, max_leaf_size, nodes);
+
+	nodes[node_index].offset = second_child;
+	nodes[node_index].primitive_count = 0;
+	nodes[node_index].split_axis = static_cast<uint16_t>(axis);
+
+	return node_index;
+}
+
+
+void buildBVH(std::vector<BVHBuildPrimitive>& primitives, const int max_leaf_size, std::vector<BVHNode>& nodes) {
+	nodes.clear();
+
+	if (primitives.empty()) {
+		return;
+	}
+
+	// a binary tree with at least one primitive per leaf has fewer than 2n nodes
+	nodes.reserve(primitives.size() * 2);
+	buildNode(primitives, 0, static_cast<uint32_t>(primitives.size()), 0, max_leaf_size, nodes);
+	nodes.shrink_to_fit();
+}
+
+
+void StaticBVH::build(const std::vector<Entity>& static_entities) {
+	nodes.clear();
+	primitive_boxes.clear();
+	primitive_ids.clear();
+	primitive_meshes.clear();
+	primitive_spheres.clear();
+
+	std::vector<BVHBuildPrimitive> primitives;
+	primitives.reserve(static_entities.size());
+
+	for (size_t i = 0; i < static_entities.size(); i++) {
+		const Entity& ent = static_entities[i];
+
+		if (ent.collision.type == Collision::Type::none) {
+			continue;
+		}
+
+		AABB box = ent.collision.getBounds();
+		primitives.push_back({box, (box.min_pos + box.max_pos) * 0.5f, static_cast<uint32_t>(i)});
+	}
+
+	buildBVH(primitives, kMaxLeafSize, nodes);
+
+	primitive_boxes.reserve(primitives.size());
+	primitive_ids.reserve(primitives.size());
+	primitive_meshes.reserve(primitives.size());
+	primitive_spheres.reserve(primitives.size());
+
+	for (const BVHBuildPrimitive& prim : primitives) {
+		const Collision& collision = static_entities[prim.id].collision;
+
+		primitive_boxes.push_back(prim.box);
+		primitive_ids.push_back(static_cast<StaticEntityIndex>(prim.id));
+		primitive_meshes.push_back(collision.type == Collision::Type::mesh ? collision.shape.mesh : nullptr);
+		primitive_spheres.push_back(collision.type == Collision::Type::sphere ? collision.shape.sphere : Sphere{glm::vec3(0.0f), 0.0f});
+	}
+
+	util::log(
+			"built static BVH: %zu primitives, %zu nodes",
+			primitive_boxes.size(),
+			nodes.size());
+}
+
+
+// for a ray that made it into a sphere primitive's box, radius grows the sphere
+// like it grows the boxes
+// the ray doesn't have to be normalized (projectiles pass their whole path), so
+// t comes back in the ray's own units
+static bool rayVsSpherePrimitive(const Ray& ray, const Sphere& sphere, const float radius, float& t) {
+	float length = glm::length(ray.direction);
+
+	if (length == 0.0f) {
+		return false;
+	}
+
+	float t_normalized;
+
+	if (!raySphere(ray.origin, ray.direction / length, sphere.center_start, sphere.radius + radius, t_normalized)) {
+		return false;
+	}
+
+	t = t_normalized / length;
+
+	return true;
+}
+
+
+// the face of the box the point is closest to
+static glm::vec3 faceNormal(const AABB& box, const glm::vec3& point) {
+	glm::vec3 normal{0.0f};
+	float closest_distance = std::numeric_limits<float>::max();
+
+	for (int axis = 0; axis < 3; axis++) {
+		float min_distance = std::abs(point[axis] - box.min_pos[axis]);
+		float max_distance = std::abs(box.max_pos[axis] - point[axis]);
+
+		if (min_distance < closest_distance) {
+			closest_distance = min_distance;
+			normal = glm::vec3(0.0f);
+			normal[axis] = -1.0f;
+		}
+
+		if (max_distance < closest_distance) {
+			closest_distance = max_distance;
+			normal = glm::vec3(0.0f);
+			normal[axis] = 1.0f;
+		}
+	}
+
+	return normal;
+}
+
+
+const bool StaticBVH::closestHit(const Ray& ray, RayHit& hit, float t_max, const float radius) const {
+	if (!isBuilt()) {
+		return false;
+	}
+
+	RayInverse ray_inverse = RayInverse::fromRay(ray);
+	glm::vec3 radius_extent(radius);
+	bool found_hit = false;
+	uint32_t hit_primitive = 0;
+	glm::vec3 mesh_hit_normal{0.0f};
+
+	uint32_t stack[kMaxDepth + 1];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		const BVHNode& node = nodes[stack[--stack_size]];
+		float t_enter;
+
+		AABB node_box{node.min_pos - radius_extent, node.max_pos + radius_extent};
+
+		if (!rayAABBInverse(ray_inverse, node_box, t_max, t_enter)) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (uint32_t i = node.offset; i < node.offset + node.primitive_count; i++) {
+				AABB primitive_box{primitive_boxes[i].min_pos - radius_extent, primitive_boxes[i].max_pos + radius_extent};
+				float t_primitive;
+
+				if (!rayAABBInverse(ray_inverse, primitive_box, t_max, t_primitive)) {
+					continue;
+				}
+
+				if (primitive_meshes[i]) {
+					// that was only the mesh's bounds, now for its triangles
+					if (primitive_meshes[i]->closestHit(ray, t_max, mesh_hit_normal, radius)) {
+						found_hit = true;
+						hit_primitive = i;
+					}
+				} else if (primitive_spheres[i].radius > 0.0f) {
+					// same for spheres, the box was just the first cut
+					float t_sphere;
+
+					if (rayVsSpherePrimitive(ray, primitive_spheres[i], radius, t_sphere) && t_sphere <= t_max) {
+						found_hit = true;
+						t_max = t_sphere;
+						hit_primitive = i;
+					}
+				} else if (!found_hit || t_primitive < t_max) {
+					found_hit = true;
+					t_max = t_primitive;
+					hit_primitive = i;
+				}
+			}
+		} else {
+			uint32_t first_child = static_cast<uint32_t>(&node - nodes.data()) + 1;
+			uint32_t near_child = first_child;
+			uint32_t far_child = node.offset;
+
+			if (ray.direction[node.split_axis] < 0.0f) {
+				std::swap(near_child, far_child);
+			}
+
+			// near child goes on top so it gets visited first, which lets t_max
+			// shrink early and cull more of the far side
+			stack[stack_size++] = far_child;
+			stack[stack_size++] = near_child;
+		}
+	}
+
+	if (found_hit) {
+		AABB hit_box{primitive_boxes[hit_primitive].min_pos - radius_extent, primitive_boxes[hit_primitive].max_pos + radius_extent};
+
+		hit.t = t_max;
+		hit.point = ray.origin + ray.direction * t_max;
+
+		if (primitive_meshes[hit_primitive]) {
+			hit.normal = mesh_hit_normal;
+		} else if (primitive_spheres[hit_primitive].radius > 0.0f) {
+			glm::vec3 center_to_point = hit.point - primitive_spheres[hit_primitive].center_start;
+			float distance = glm::length(center_to_point);
+
+			// the ray started inside, so push back the way it came
+			hit.normal = distance > 0.0f ? center_to_point / distance : -glm::normalize(ray.direction);
+		} else {
+			hit.normal = faceNormal(hit_box, hit.point);
+		}
+
+		hit.entity_index = primitive_ids[hit_primitive];
+	}
+
+	return found_hit;
+}
+
+
+const bool StaticBVH::anyHit(const Ray& ray, float t_max) const {
+	if (!isBuilt()) {
+		return false;
+	}
+
+	RayInverse ray_inverse = RayInverse::fromRay(ray);
+
+	uint32_t stack[kMaxDepth + 1];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		const BVHNode& node = nodes[stack[--stack_size]];
+		float t_enter;
+
+		if (!rayAABBInverse(ray_inverse, AABB{node.min_pos, node.max_pos}, t_max, t_enter)) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (uint32_t i = node.offset; i < node.offset + node.primitive_count; i++) {
+				if (!rayAABBInverse(ray_inverse, primitive_boxes[i], t_max, t_enter)) {
+					continue;
+				}
+
+				if (primitive_meshes[i]) {
+					if (primitive_meshes[i]->anyHit(ray, t_max)) {
+						return true;
+					}
+				} else if (primitive_spheres[i].radius > 0.0f) {
+					float t_sphere;
+
+					if (rayVsSpherePrimitive(ray, primitive_spheres[i], 0.0f, t_sphere) && t_sphere <= t_max) {
+						return true;
+					}
+				} else {
+					return true;
+				}
+			}
+		} else {
+			stack[stack_size++] = node.offset;
+			stack[stack_size++] = static_cast<uint32_t>(&node - nodes.data()) + 1;
+		}
+	}
+
+	return false;
+}
+
+
+void RayPacketHits::reset(const RayPacket& rays, const float t_max) {
+	size_t padded_count = rays.paddedCount();
+
+	t.assign(padded_count, t_max);
+	points.assign(padded_count, glm::vec3(0.0f));
+	entity_indices.assign(padded_count, 0);
+	did_hit.assign(padded_count, 0);
+	t_enter.resize(padded_count);
+
+	// padding rays start out finished
+	t_limit.assign(padded_count, -1.0f);
+	std::fill(t_limit.begin(), t_limit.begin() + rays.count, t_max);
+}
+
+
+// shared by closestHits and anyHits, t_limit decides how far each ray can go
+static void traversePacket(
+		const StaticBVH& bvh,
+		const RayPacket& rays,
+		RayPacketHits& hits,
+		const bool stop_at_first_hit) {
+	const std::vector<BVHNode>& nodes = bvh.nodes;
+
+	if (!bvh.isBuilt()) {
+		return;
+	}
+
+	for (size_t chunk_start = 0; chunk_start < rays.paddedCount(); chunk_start += StaticBVH::kPacketChunkSize) {
+		size_t chunk_count = std::min(StaticBVH::kPacketChunkSize, rays.paddedCount() - chunk_start);
+
+		// each stack entry remembers which rays made it into the node's parent,
+		// so rays that already missed don't get tested further down
+		struct StackEntry {
+			uint32_t node_index;
+			uint64_t ray_mask;
+		};
+
+		StackEntry stack[StaticBVH::kMaxDepth + 1];
+		int stack_size = 0;
+		uint64_t chunk_mask = chunk_count == 64 ? ~uint64_t(0) : (uint64_t(1) << chunk_count) - 1;
+		stack[stack_size++] = {0, chunk_mask};
+
+		while (stack_size > 0) {
+			StackEntry entry = stack[--stack_size];
+			const BVHNode& node = nodes[entry.node_index];
+			uint64_t active_mask = simd::raysVsAABB(
+					rays,
+					chunk_start,
+					chunk_count,
+					AABB{node.min_pos, node.max_pos},
+					entry.ray_mask,
+					hits.t_limit.data(),
+					hits.t_enter.data());
+
+			if (active_mask == 0) {
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				for (uint32_t i = node.offset; i < node.offset + node.primitive_count; i++) {
+					const TriangleMesh* mesh = bvh.primitive_meshes[i];
+					const Sphere& sphere = bvh.primitive_spheres[i];
+					uint64_t hit_mask = simd::raysVsAABB(
+							rays,
+							chunk_start,
+							chunk_count,
+							bvh.primitive_boxes[i],
+							active_mask,
+							hits.t_limit.data(),
+							hits.t_enter.data());
+
+					while (hit_mask != 0) {
+						int bit = util::countTrailingZeros64(hit_mask);
+						hit_mask &= hit_mask - 1;
+
+						size_t ray_index = chunk_start + bit;
+						float t_primitive = hits.t_enter[ray_index];
+
+						if (mesh) {
+							// meshes fall back to one ray at a time through their own BVH
+							glm::vec3 normal;
+							t_primitive = hits.t_limit[ray_index];
+
+							if (!mesh->closestHit(rays.getRay(ray_index), t_primitive, normal)) {
+								continue;
+							}
+						} else if (sphere.radius > 0.0f) {
+							// and so do spheres
+							if (!rayVsSpherePrimitive(rays.getRay(ray_index), sphere, 0.0f, t_primitive)
+									|| t_primitive > hits.t_limit[ray_index]) {
+								continue;
+							}
+						}
+
+						if (!hits.did_hit[ray_index] || t_primitive < hits.t[ray_index]) {
+							hits.did_hit[ray_index] = 1;
+							hits.t[ray_index] = t_primitive;
+							hits.entity_indices[ray_index] = bvh.primitive_ids[i];
+							hits.t_limit[ray_index] = stop_at_first_hit ? -1.0f : t_primitive;
+						}
+					}
+				}
+			} else {
+				// packets are assumed to be coherent, so order children by the first
+				// active ray
+				int first_active = util::countTrailingZeros64(active_mask);
+
+				const std::vector<float>& directions =
+						node.split_axis == 0 ? rays.direction_x
+						: node.split_axis == 1 ? rays.direction_y
+						: rays.direction_z;
+
+				uint32_t near_child = static_cast<uint32_t>(&node - nodes.data()) + 1;
+				uint32_t far_child = node.offset;
+
+				if (directions[chunk_start + first_active] < 0.0f) {
+					std::swap(near_child, far_child);
+				}
+
+				stack[stack_size++] = {far_child, active_mask};
+				stack[stack_size++] = {near_child, active_mask};
+			}
+		}
+	}
+
+	for (size_t i = 0; i < rays.count; i++) {
+		if (hits.did_hit[i]) {
+			Ray ray = rays.getRay(i);
+			hits.points[i] = ray.origin + ray.direction * hits.t[i];
+		}
+	}
+}
+
+
+void StaticBVH::closestHits(const RayPacket& rays, RayPacketHits& hits, const float t_max) const {
+	hits.reset(rays, t_max);
+	traversePacket(*this, rays, hits, false);
+}
+
+
+void StaticBVH::anyHits(const RayPacket& rays, RayPacketHits& hits, const float t_max) const {
+	hits.reset(rays, t_max);
+	traversePacket(*this, rays, hits, true);
+}
+
+
+void StaticBVH::collectOverlaps(const OverlapQuery* queries, const size_t query_count, OverlapResults* results) const {
+	if (!isBuilt()) {
+		return;
+	}
+
+	for (size_t chunk_start = 0; chunk_start < query_count; chunk_start += kOverlapChunkSize) {
+		size_t chunk_count = std::min(kOverlapChunkSize, query_count - chunk_start);
+		uint64_t chunk_mask = 0;
+
+		for (size_t i = 0; i < chunk_count; i++) {
+			if (queries[chunk_start + i].include_static) {
+				chunk_mask |= uint64_t(1) << i;
+			}
+		}
+
+		// same idea as traversePacket, queries that missed a node don't get
+		// tested against anything under it
+		struct StackEntry {
+			uint32_t node_index;
+			uint64_t query_mask;
+		};
+
+		StackEntry stack[kMaxDepth + 1];
+		int stack_size = 0;
+
+		if (chunk_mask != 0) {
+			stack[stack_size++] = {0, chunk_mask};
+		}
+
+		while (stack_size > 0) {
+			StackEntry entry = stack[--stack_size];
+			const BVHNode& node = nodes[entry.node_index];
+			AABB node_bounds{node.min_pos, node.max_pos};
+			uint64_t active_mask = 0;
+
+			for (uint64_t mask = entry.query_mask; mask != 0; mask &= mask - 1) {
+				int bit = util::countTrailingZeros64(mask);
+
+				if (queries[chunk_start + bit].overlaps(node_bounds)) {
+					active_mask |= uint64_t(1) << bit;
+				}
+			}
+
+			if (active_mask == 0) {
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				for (uint32_t i = node.offset; i < node.offset + node.primitive_count; i++) {
+					for (uint64_t mask = active_mask; mask != 0; mask &= mask - 1) {
+						int bit = util::countTrailingZeros64(mask);
+
+						if (queries[chunk_start + bit].overlaps(primitive_boxes[i])) {
+							results[chunk_start + bit].add(OverlapHit::Kind::static_entity, primitive_ids[i]);
+						}
+					}
+				}
+			} else {
+				stack[stack_size++] = {node.offset, active_mask};
+				stack[stack_size++] = {entry.node_index + 1, active_mask};
+			}
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <collision.h>
+#include <collision_simd.h>
+#include <entity.h>
+#include <overlap_query.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+// 32 bytes, so two nodes share a cache line
+// nodes are stored depth first: an interior node's first child is always the
+// next node in the array, so only the second child's index needs storing
+struct BVHNode {
+	glm::vec3 min_pos;
+	uint32_t offset; // leaf: first primitive index, interior: second child index
+	glm::vec3 max_pos;
+	uint16_t primitive_count; // 0 for interior nodes
+	uint16_t split_axis;
+
+	const bool isLeaf() const {
+		return primitive_count > 0;
+	}
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode should stay cache friendly");
+
+static constexpr int kBVHMaxDepth = 64;
+static constexpr int kBVHSAHBinCount = 12;
+
+
+// id is whatever the caller needs to find the primitive again afterwards
+struct BVHBuildPrimitive {
+	AABB box;
+	glm::vec3 centroid;
+	uint32_t id;
+};
+
+// builds a tree over primitives with a binned surface area heuristic, in the
+// depth first layout described above
+// primitives gets reordered so every leaf refers to a contiguous range of it
+void buildBVH(std::vector<BVHBuildPrimitive>& primitives, const int max_leaf_size, std::vector<BVHNode>& nodes);
+
+
+struct RayHit {
+	float t = std::numeric_limits<float>::max();
+	glm::vec3 point{0.0f};
+	glm::vec3 normal{0.0f}; // of the face that was hit
+	StaticEntityIndex entity_index = 0; // into Scene::static_entities
+};
+
+
+// per ray results of a packet query, indexed the same as the packet
+struct RayPacketHits {
+	std::vector<float> t;
+	std::vector<glm::vec3> points;
+	std::vector<StaticEntityIndex> entity_indices;
+	std::vector<uint8_t> did_hit;
+
+	// used during traversal
+	std::vector<float> t_limit; // how far each ray can still go, negative once it's done
+	std::vector<float> t_enter;
+
+	void reset(const RayPacket& rays, const float t_max);
+};
+
+
+// bounding volume hierarchy over every static AABB, sphere and triangle mesh
+// this only needs rebuilding when the level (i.e. the set of static entities)
+// changes
+// meshes are a single primitive here, and rays that reach one carry on into
+// the mesh's own BVH, rays that reach a sphere's box get an exact sphere test
+struct StaticBVH {
+	static constexpr int kMaxLeafSize = 4;
+	static constexpr int kMaxDepth = kBVHMaxDepth;
+	// rays in a packet are walked through the tree this many at a time, with
+	// one bit of a mask each
+	static constexpr size_t kPacketChunkSize = 64;
+
+	std::vector<BVHNode> nodes;
+	// primitives are reordered so every leaf refers to a contiguous range
+	std::vector<AABB> primitive_boxes;
+	std::vector<StaticEntityIndex> primitive_ids;
+	std::vector<const TriangleMesh*> primitive_meshes; // nullptr for boxes and spheres
+	std::vector<Sphere> primitive_spheres; // radius 0 for boxes and meshes
+
+	void build(const std::vector<Entity>& static_entities);
+
+	// nearest hit along the ray within [0, t_max]
+	// a radius turns this into a cheap sphere sweep, by growing every box by that
+	// much (the corners and edges are square instead of rounded, which is close
+	// enough for small things like projectiles)
+	const bool closestHit(
+			const Ray& ray,
+			RayHit& hit,
+			float t_max = std::numeric_limits<float>::max(),
+			const float radius = 0.0f) const;
+
+	// stops at the first hit found within [0, t_max], for visibility checks
+	const bool anyHit(const Ray& ray, float t_max = std::numeric_limits<float>::max()) const;
+
+	// closestHit and anyHit for every ray in a packet
+	// each chunk of rays visits a node together, so coherent rays (e.g. line of
+	// sight checks from one spot) share node fetches and box tests are vectorized
+	// across rays
+	void closestHits(
+			const RayPacket& rays,
+			RayPacketHits& hits,
+			const float t_max = std::numeric_limits<float>::max()) const;
+	void anyHits(
+			const RayPacket& rays,
+			RayPacketHits& hits,
+			const float t_max = std::numeric_limits<float>::max()) const;
+
+	// adds every static entity whose collision bounds overlap queries[i] to
+	// results[i], for queries that include static entities
+	// meshes and spheres count by their bounding box
+	void collectOverlaps(const OverlapQuery* queries, const size_t query_count, OverlapResults* results) const;
+
+	const bool isBuilt() const {
+		return !nodes.empty();
+	}
+};
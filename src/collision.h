@@ -4,6 +4,9 @@
 
 #include <glm/glm.hpp>
 
+#include <cmath>
+#include <limits>
+
 
 struct Sphere {
 	glm::vec3 center_start; // center position as of the end of the last frame
@@ -21,6 +24,59 @@ struct Ray {
 	glm::vec3 direction;
 };
 
+// six planes facing inwards (xyz is the unit normal, w the offset), so a point
+// p is inside when dot(xyz, p) + w >= 0 for all of them
+struct Frustum {
+	glm::vec4 planes[6];
+
+	// gribb & hartmann, works for any projection * view matrix
+	static Frustum fromMatrix(const glm::mat4& view_projection) {
+		glm::vec4 rows[4];
+
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+		}
+
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0]; // left
+		frustum.planes[1] = rows[3] - rows[0]; // right
+		frustum.planes[2] = rows[3] + rows[1]; // bottom (or top, if y is flipped)
+		frustum.planes[3] = rows[3] - rows[1];
+		frustum.planes[4] = rows[3] + rows[2]; // near
+		frustum.planes[5] = rows[3] - rows[2]; // far
+
+		for (glm::vec4& plane : frustum.planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+
+		return frustum;
+	}
+};
+
+// a ray with its direction reciprocal precomputed, for testing one ray against
+// lots of boxes without dividing every time
+struct RayInverse {
+	glm::vec3 origin;
+	glm::vec3 inv_direction;
+
+	static RayInverse fromRay(const Ray& ray) {
+		constexpr float kTinyDirection = 1e-30f;
+		RayInverse result;
+		result.origin = ray.origin;
+
+		for (int i = 0; i < 3; i++) {
+			// keep things finite so that a zero offset never produces a NaN
+			float direction_el = ray.direction[i];
+			if (std::abs(direction_el) < kTinyDirection) {
+				direction_el = std::copysign(kTinyDirection, direction_el);
+			}
+			result.inv_direction[i] = 1.0f / direction_el;
+		}
+
+		return result;
+	}
+};
+
 
 static bool rayAABB(Ray ray, AABB box, float& t_min, glm::vec3& collision_point) {
 	t_min = 0.0f;
@@ -33,7 +89,7 @@ static bool rayAABB(Ray ray, AABB box, float& t_min, glm::vec3& collision_point)
 		float box_min_ex = box.min_pos[i];
 		float box_max_ex = box.max_pos[i];
 
-		if (abs(ray.direction[i]) < util::kEpsilon) {
+		if (std::abs(ray.direction[i]) < util::kEpsilon) {
 			// ray is parallel to slab
 			if (origin_el < box_min_ex || origin_el > box_max_ex) {
 				// origin is not within slab
@@ -64,6 +120,20 @@ static bool rayAABB(Ray ray, AABB box, float& t_min, glm::vec3& collision_point)
 }
 
 
+// branchless slab test, t_enter is 0 if the origin is inside the box
+static bool rayAABBInverse(const RayInverse& ray, const AABB& box, const float t_max, float& t_enter) {
+	glm::vec3 t1 = (box.min_pos - ray.origin) * ray.inv_direction;
+	glm::vec3 t2 = (box.max_pos - ray.origin) * ray.inv_direction;
+	glm::vec3 t_near = glm::min(t1, t2);
+	glm::vec3 t_far = glm::max(t1, t2);
+
+	t_enter = std::fmax(std::fmax(t_near.x, t_near.y), std::fmax(t_near.z, 0.0f));
+	float t_exit = std::fmin(std::fmin(t_far.x, t_far.y), std::fmin(t_far.z, t_max));
+
+	return t_enter <= t_exit;
+}
+
+
 // real time collision detection pg. 131
 static float squaredDistanceToAABB(glm::vec3 point, AABB box) {
 	float squared_distance = 0.0;
@@ -86,6 +156,48 @@ static float squaredDistanceToAABB(glm::vec3 point, AABB box) {
 	return squared_distance;
 }
 
+// touching counts as overlapping
+static bool aabbsOverlap(const AABB& first, const AABB& second) {
+	return glm::all(glm::lessThanEqual(first.min_pos, second.max_pos))
+			&& glm::all(glm::lessThanEqual(second.min_pos, first.max_pos));
+}
+
+// whether inner is entirely inside outer
+static bool aabbContains(const AABB& outer, const AABB& inner) {
+	return glm::all(glm::lessThanEqual(outer.min_pos, inner.min_pos))
+			&& glm::all(glm::lessThanEqual(inner.max_pos, outer.max_pos));
+}
+
+static bool sphereOverlapsAABB(const glm::vec3& center, const float radius, const AABB& box) {
+	return squaredDistanceToAABB(center, box) <= radius * radius;
+}
+
+// conservative: a box that's outside the frustum but straddles two of its
+// planes near a corner still counts
+static bool frustumOverlapsAABB(const Frustum& frustum, const AABB& box) {
+	for (const glm::vec4& plane : frustum.planes) {
+		glm::vec3 normal(plane);
+		// the corner furthest along the normal
+		glm::vec3 corner = glm::mix(box.min_pos, box.max_pos, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+
+		if (glm::dot(normal, corner) + plane.w < 0.0f) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool frustumOverlapsSphere(const Frustum& frustum, const glm::vec3& center, const float radius) {
+	for (const glm::vec4& plane : frustum.planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 // real time collision detection pg. 130
 static glm::vec3 closestPointToAABB(glm::vec3 point, AABB box) {
 	// clamp point to sides of the box
@@ -108,11 +220,118 @@ static glm::vec3 closestPointToAABB(glm::vec3 point, AABB box) {
 }
 
 
+// ray vs sphere, direction must be normalized
+// t is 0 if the origin starts inside the sphere
+static bool raySphere(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const glm::vec3& center,
+		const float radius,
+		float& t) {
+	glm::vec3 center_to_origin = origin - center;
+	float b = glm::dot(center_to_origin, direction);
+	float c = glm::dot(center_to_origin, center_to_origin) - radius * radius;
+
+	if (c > 0.0f && b > 0.0f) {
+		// outside and pointing away
+		return false;
+	}
+
+	float discriminant = b * b - c;
+
+	if (discriminant < 0.0f) {
+		return false;
+	}
+
+	t = std::fmax(-b - std::sqrt(discriminant), 0.0f);
+
+	return true;
+}
+
+// ray vs capsule (the segment from a to b, inflated by radius), direction must
+// be normalized
+static bool rayCapsule(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const glm::vec3& a,
+		const glm::vec3& b,
+		const float radius,
+		float& t) {
+	bool did_hit = false;
+	t = std::numeric_limits<float>::max();
+
+	// infinite cylinder around the segment first, only counting hits between the caps
+	glm::vec3 ab = b - a;
+	glm::vec3 a_to_origin = origin - a;
+	float ab_ab = glm::dot(ab, ab);
+	float ab_dir = glm::dot(ab, direction);
+	float ab_origin = glm::dot(ab, a_to_origin);
+
+	float qa = ab_ab - ab_dir * ab_dir;
+	float qb = ab_ab * glm::dot(direction, a_to_origin) - ab_origin * ab_dir;
+	float qc = ab_ab * glm::dot(a_to_origin, a_to_origin) - ab_origin * ab_origin - radius * radius * ab_ab;
+	float discriminant = qb * qb - qa * qc;
+
+	if (qa > util::kEpsilon && discriminant >= 0.0f) {
+		float t_cylinder = (-qb - std::sqrt(discriminant)) / qa;
+		float along_axis = ab_origin + t_cylinder * ab_dir;
+
+		if (t_cylinder >= 0.0f && along_axis > 0.0f && along_axis < ab_ab) {
+			did_hit = true;
+			t = t_cylinder;
+		}
+	}
+
+	// then the end caps
+	float t_cap;
+
+	if (raySphere(origin, direction, a, radius, t_cap) && t_cap < t) {
+		did_hit = true;
+		t = t_cap;
+	}
+
+	if (raySphere(origin, direction, b, radius, t_cap) && t_cap < t) {
+		did_hit = true;
+		t = t_cap;
+	}
+
+	return did_hit;
+}
+
+// corner n of the box, bit i of n picks max (1) or min (0) along axis i
+static glm::vec3 cornerOfAABB(const AABB& box, const int n) {
+	return glm::vec3(
+			(n & 1) ? box.max_pos.x : box.min_pos.x,
+			(n & 2) ? box.max_pos.y : box.min_pos.y,
+			(n & 4) ? box.max_pos.z : box.min_pos.z);
+}
+
+
+// result of sweeping a sphere into something
+struct SweepHit {
+	float t = 1.0f; // fraction of the path travelled before touching
+	glm::vec3 normal{0.0f}; // points away from the thing that was hit
+	float penetration = 0.0f; // only non-zero if the sphere started out overlapping
+};
+
+
+// static triangle soup with its own BVH, see triangle_mesh.h
+// these just forward to it, so this header doesn't need to know about BVHs
+struct TriangleMesh;
+const AABB getTriangleMeshBounds(const TriangleMesh& mesh);
+const bool sweptSphereVsTriangleMesh(
+		const Sphere& sphere,
+		const glm::vec3& sphere_center_end,
+		const TriangleMesh& mesh,
+		SweepHit& hit);
+
+
 struct Collision {
 	enum class Type {
 		none,
 		sphere,
-		aabb
+		aabb,
+		mesh // static only, already in world space
 	};
 
 	Type type = Type::none;
@@ -120,8 +339,23 @@ struct Collision {
 	union Shape {
 		Sphere sphere;
 		AABB box;
+		const TriangleMesh* mesh; // owned by the scene (see Scene::setMeshCollision)
 	} shape;
 
+	// world space bounds of the shape (spheres use their start position)
+	const AABB getBounds() const {
+		if (type == Type::sphere) {
+			glm::vec3 extent(shape.sphere.radius);
+			return AABB{shape.sphere.center_start - extent, shape.sphere.center_start + extent};
+		}
+
+		if (type == Type::mesh) {
+			return getTriangleMeshBounds(*shape.mesh);
+		}
+
+		return shape.box;
+	}
+
 	// two options:
 	// 1. sweep AABB by radius, do collision with sphere direction vector, if collided, do collision with collision point and AABB
 	static bool sphereVsAABB(
@@ -146,4 +380,176 @@ struct Collision {
 		// 		squared_distance_to_center > squared_sphere_radius);
 		return squared_distance_to_center <= squared_sphere_radius;
 	}
+
+	// real time collision detection pg. 229
+	// sweeps the sphere from sphere.center_start to sphere_center_end and finds
+	// the first time it touches the box
+	// this is a ray test against the box grown by the sphere radius; when the
+	// ray enters near an edge or corner, the grown box is too generous there, so
+	// the edge capsules get tested instead
+	static bool sweptSphereVsAABB(
+			const Sphere& sphere,
+			const glm::vec3& sphere_center_end,
+			const AABB& box,
+			SweepHit& hit) {
+		const glm::vec3& start = sphere.center_start;
+		float squared_radius = sphere.radius * sphere.radius;
+
+		// already overlapping, push out along the shortest way
+		glm::vec3 closest_point = closestPointToAABB(start, box);
+		glm::vec3 closest_to_start = start - closest_point;
+		float squared_distance = glm::dot(closest_to_start, closest_to_start);
+
+		if (squared_distance < squared_radius) {
+			hit.t = 0.0f;
+
+			if (squared_distance > util::kEpsilon * util::kEpsilon) {
+				float distance = std::sqrt(squared_distance);
+				hit.normal = closest_to_start / distance;
+				hit.penetration = sphere.radius - distance;
+			} else {
+				// center is inside the box, find the nearest face
+				glm::vec3 to_min = start - box.min_pos;
+				glm::vec3 to_max = box.max_pos - start;
+				float nearest = std::numeric_limits<float>::max();
+
+				for (int i = 0; i < 3; i++) {
+					if (to_min[i] < nearest) {
+						nearest = to_min[i];
+						hit.normal = glm::vec3(0.0f);
+						hit.normal[i] = -1.0f;
+					}
+
+					if (to_max[i] < nearest) {
+						nearest = to_max[i];
+						hit.normal = glm::vec3(0.0f);
+						hit.normal[i] = 1.0f;
+					}
+				}
+
+				hit.penetration = nearest + sphere.radius;
+			}
+
+			return true;
+		}
+
+		glm::vec3 path = sphere_center_end - start;
+		float path_length = glm::length(path);
+
+		if (path_length < util::kEpsilon) {
+			return false;
+		}
+
+		glm::vec3 direction = path / path_length;
+
+		glm::vec3 radius_extent(sphere.radius);
+		AABB expanded_box{box.min_pos - radius_extent, box.max_pos + radius_extent};
+		float t;
+
+		if (!rayAABBInverse(RayInverse::fromRay(Ray{start, direction}), expanded_box, path_length, t)) {
+			return false;
+		}
+
+		// figure out which voronoi region of the original box the entry point is in
+		glm::vec3 entry_point = start + direction * t;
+		int below_min = 0;
+		int above_max = 0;
+
+		for (int i = 0; i < 3; i++) {
+			if (entry_point[i] < box.min_pos[i]) {
+				below_min |= 1 << i;
+			}
+			if (entry_point[i] > box.max_pos[i]) {
+				above_max |= 1 << i;
+			}
+		}
+
+		int region = below_min | above_max;
+		int outside_axis_count = ((region >> 0) & 1) + ((region >> 1) & 1) + ((region >> 2) & 1);
+
+		if (outside_axis_count == 3) {
+			// vertex region, test the three edges that meet at this corner
+			glm::vec3 corner = cornerOfAABB(box, above_max);
+			float t_edge;
+			bool did_hit = false;
+			t = std::numeric_limits<float>::max();
+
+			for (int axis_bit = 1; axis_bit <= 4; axis_bit <<= 1) {
+				glm::vec3 other_corner = cornerOfAABB(box, above_max ^ axis_bit);
+
+				if (rayCapsule(start, direction, corner, other_corner, sphere.radius, t_edge) && t_edge < t) {
+					did_hit = true;
+					t = t_edge;
+				}
+			}
+
+			if (!did_hit) {
+				return false;
+			}
+		} else if (outside_axis_count == 2) {
+			// edge region
+			glm::vec3 edge_start = cornerOfAABB(box, below_min ^ 7);
+			glm::vec3 edge_end = cornerOfAABB(box, above_max);
+
+			if (!rayCapsule(start, direction, edge_start, edge_end, sphere.radius, t)) {
+				return false;
+			}
+		}
+
+		if (t > path_length) {
+			return false;
+		}
+
+		glm::vec3 contact_center = start + direction * t;
+		hit.t = t / path_length;
+		hit.normal = util::safeNormalize(contact_center - closestPointToAABB(contact_center, box));
+		hit.penetration = 0.0f;
+
+		if (util::isVectorZero(hit.normal)) {
+			hit.normal = -direction;
+		}
+
+		return true;
+	}
+
+	// sweeps the sphere from sphere.center_start to sphere_center_end against a
+	// sphere that isn't moving
+	static bool sweptSphereVsSphere(
+			const Sphere& sphere,
+			const glm::vec3& sphere_center_end,
+			const Sphere& other_sphere,
+			SweepHit& hit) {
+		const glm::vec3& start = sphere.center_start;
+		float combined_radius = sphere.radius + other_sphere.radius;
+		glm::vec3 separation = start - other_sphere.center_start;
+		float squared_distance = glm::dot(separation, separation);
+
+		if (squared_distance < combined_radius * combined_radius) {
+			float distance = std::sqrt(squared_distance);
+			hit.t = 0.0f;
+			hit.normal = distance > util::kEpsilon ? separation / distance : glm::vec3(0.0f, 0.0f, 1.0f);
+			hit.penetration = combined_radius - distance;
+			return true;
+		}
+
+		glm::vec3 path = sphere_center_end - start;
+		float path_length = glm::length(path);
+
+		if (path_length < util::kEpsilon) {
+			return false;
+		}
+
+		glm::vec3 direction = path / path_length;
+		float t;
+
+		if (!raySphere(start, direction, other_sphere.center_start, combined_radius, t) || t > path_length) {
+			return false;
+		}
+
+		hit.t = t / path_length;
+		hit.normal = glm::normalize(start + direction * t - other_sphere.center_start);
+		hit.penetration = 0.0f;
+
+		return true;
+	}
 };
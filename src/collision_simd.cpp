@@ -0,0 +1,679 @@
+#include <collision_simd.h>
+
+#include <util.h>
+
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SEVERIN_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define SEVERIN_SIMD_X86 0
+#endif
+
+#if SEVERIN_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+// lets us compile AVX2 functions without building the whole engine with -mavx2
+#define SEVERIN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SEVERIN_TARGET_AVX2
+#endif
+
+
+void AABBBatch::clear() {
+	min_x.clear();
+	min_y.clear();
+	min_z.clear();
+	max_x.clear();
+	max_y.clear();
+	max_z.clear();
+	count = 0;
+}
+
+void AABBBatch::reserve(size_t box_count) {
+	size_t padded = (box_count + kPadding - 1) / kPadding * kPadding;
+	min_x.reserve(padded);
+	min_y.reserve(padded);
+	min_z.reserve(padded);
+	max_x.reserve(padded);
+	max_y.reserve(padded);
+	max_z.reserve(padded);
+}
+
+void AABBBatch::add(const AABB& box) {
+	if (count == paddedCount()) {
+		// grow by a full pad of inside out boxes, which are infinitely far from
+		// everything
+		constexpr float kMax = std::numeric_limits<float>::max();
+		size_t padded = count + kPadding;
+		min_x.resize(padded, kMax);
+		min_y.resize(padded, kMax);
+		min_z.resize(padded, kMax);
+		max_x.resize(padded, -kMax);
+		max_y.resize(padded, -kMax);
+		max_z.resize(padded, -kMax);
+	}
+
+	min_x[count] = box.min_pos.x;
+	min_y[count] = box.min_pos.y;
+	min_z[count] = box.min_pos.z;
+	max_x[count] = box.max_pos.x;
+	max_y[count] = box.max_pos.y;
+	max_z[count] = box.max_pos.z;
+	count++;
+}
+
+
+void RayPacket::clear() {
+	origin_x.clear();
+	origin_y.clear();
+	origin_z.clear();
+	direction_x.clear();
+	direction_y.clear();
+	direction_z.clear();
+	inv_direction_x.clear();
+	inv_direction_y.clear();
+	inv_direction_z.clear();
+	count = 0;
+}
+
+void RayPacket::add(const Ray& ray) {
+	if (count == paddedCount()) {
+		// padding rays sit at the origin pointing nowhere, queries give them a
+		// negative t_max so they never hit
+		size_t padded = count + kPadding;
+		origin_x.resize(padded, 0.0f);
+		origin_y.resize(padded, 0.0f);
+		origin_z.resize(padded, 0.0f);
+		direction_x.resize(padded, 0.0f);
+		direction_y.resize(padded, 0.0f);
+		direction_z.resize(padded, 0.0f);
+		inv_direction_x.resize(padded, 0.0f);
+		inv_direction_y.resize(padded, 0.0f);
+		inv_direction_z.resize(padded, 0.0f);
+	}
+
+	RayInverse ray_inverse = RayInverse::fromRay(ray);
+
+	origin_x[count] = ray.origin.x;
+	origin_y[count] = ray.origin.y;
+	origin_z[count] = ray.origin.z;
+	direction_x[count] = ray.direction.x;
+	direction_y[count] = ray.direction.y;
+	direction_z[count] = ray.direction.z;
+	inv_direction_x[count] = ray_inverse.inv_direction.x;
+	inv_direction_y[count] = ray_inverse.inv_direction.y;
+	inv_direction_z[count] = ray_inverse.inv_direction.z;
+	count++;
+}
+
+
+// ****************************************************************************
+// scalar, just loops over the existing helpers
+// ****************************************************************************
+static void squaredDistancesScalar(const glm::vec3& point, const AABBBatch& boxes, float* out) {
+	for (size_t i = 0; i < boxes.paddedCount(); i++) {
+		out[i] = squaredDistanceToAABB(point, boxes.getBox(i));
+	}
+}
+
+static void closestPointsScalar(
+		const glm::vec3& point,
+		const AABBBatch& boxes,
+		float* out_x,
+		float* out_y,
+		float* out_z) {
+	for (size_t i = 0; i < boxes.paddedCount(); i++) {
+		glm::vec3 closest = closestPointToAABB(point, boxes.getBox(i));
+		out_x[i] = closest.x;
+		out_y[i] = closest.y;
+		out_z[i] = closest.z;
+	}
+}
+
+static size_t sphereVsAABBsScalar(
+		const glm::vec3& center,
+		const float radius,
+		const AABBBatch& boxes,
+		uint32_t* out_hit_indices,
+		glm::vec3* out_closest_points) {
+	Sphere sphere{center, radius};
+	size_t hit_count = 0;
+
+	for (size_t i = 0; i < boxes.count; i++) {
+		glm::vec3 closest;
+
+		if (Collision::sphereVsAABB(sphere, center, boxes.getBox(i), closest)) {
+			out_hit_indices[hit_count] = static_cast<uint32_t>(i);
+			out_closest_points[hit_count] = closest;
+			hit_count++;
+		}
+	}
+
+	return hit_count;
+}
+
+static size_t frustumVsAABBsScalar(
+		const Frustum& frustum,
+		const AABBBatch& boxes,
+		uint32_t* out_visible_indices) {
+	size_t visible_count = 0;
+
+	for (size_t i = 0; i < boxes.count; i++) {
+		if (frustumOverlapsAABB(frustum, boxes.getBox(i))) {
+			out_visible_indices[visible_count++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	return visible_count;
+}
+
+static uint64_t raysVsAABBScalar(
+		const RayPacket& rays,
+		const size_t first,
+		const size_t count,
+		const AABB& box,
+		const uint64_t active_mask,
+		const float* t_max,
+		float* out_t_enter) {
+	uint64_t mask = 0;
+
+	for (size_t i = first; i < first + count; i++) {
+		if (!(active_mask & (uint64_t(1) << (i - first)))) {
+			continue;
+		}
+
+		RayInverse ray{
+				glm::vec3(rays.origin_x[i], rays.origin_y[i], rays.origin_z[i]),
+				glm::vec3(rays.inv_direction_x[i], rays.inv_direction_y[i], rays.inv_direction_z[i])};
+
+		if (rayAABBInverse(ray, box, t_max[i], out_t_enter[i])) {
+			mask |= uint64_t(1) << (i - first);
+		}
+	}
+
+	return mask & active_mask;
+}
+
+
+#if SEVERIN_SIMD_X86
+// ****************************************************************************
+// SSE, 4 boxes at a time
+// ****************************************************************************
+static void squaredDistancesSSE(const glm::vec3& point, const AABBBatch& boxes, float* out) {
+	__m128 px = _mm_set1_ps(point.x);
+	__m128 py = _mm_set1_ps(point.y);
+	__m128 pz = _mm_set1_ps(point.z);
+
+	for (size_t i = 0; i < boxes.paddedCount(); i += 4) {
+		__m128 dx = _mm_sub_ps(_mm_min_ps(_mm_max_ps(px, _mm_loadu_ps(&boxes.min_x[i])), _mm_loadu_ps(&boxes.max_x[i])), px);
+		__m128 dy = _mm_sub_ps(_mm_min_ps(_mm_max_ps(py, _mm_loadu_ps(&boxes.min_y[i])), _mm_loadu_ps(&boxes.max_y[i])), py);
+		__m128 dz = _mm_sub_ps(_mm_min_ps(_mm_max_ps(pz, _mm_loadu_ps(&boxes.min_z[i])), _mm_loadu_ps(&boxes.max_z[i])), pz);
+
+		__m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		_mm_storeu_ps(out + i, squared);
+	}
+}
+
+static void closestPointsSSE(
+		const glm::vec3& point,
+		const AABBBatch& boxes,
+		float* out_x,
+		float* out_y,
+		float* out_z) {
+	__m128 px = _mm_set1_ps(point.x);
+	__m128 py = _mm_set1_ps(point.y);
+	__m128 pz = _mm_set1_ps(point.z);
+
+	for (size_t i = 0; i < boxes.paddedCount(); i += 4) {
+		_mm_storeu_ps(out_x + i, _mm_min_ps(_mm_max_ps(px, _mm_loadu_ps(&boxes.min_x[i])), _mm_loadu_ps(&boxes.max_x[i])));
+		_mm_storeu_ps(out_y + i, _mm_min_ps(_mm_max_ps(py, _mm_loadu_ps(&boxes.min_y[i])), _mm_loadu_ps(&boxes.max_y[i])));
+		_mm_storeu_ps(out_z + i, _mm_min_ps(_mm_max_ps(pz, _mm_loadu_ps(&boxes.min_z[i])), _mm_loadu_ps(&boxes.max_z[i])));
+	}
+}
+
+static size_t sphereVsAABBsSSE(
+		const glm::vec3& center,
+		const float radius,
+		const AABBBatch& boxes,
+		uint32_t* out_hit_indices,
+		glm::vec3* out_closest_points) {
+	__m128 px = _mm_set1_ps(center.x);
+	__m128 py = _mm_set1_ps(center.y);
+	__m128 pz = _mm_set1_ps(center.z);
+	__m128 squared_radius = _mm_set1_ps(radius * radius);
+	size_t hit_count = 0;
+
+	alignas(16) float closest_x[4];
+	alignas(16) float closest_y[4];
+	alignas(16) float closest_z[4];
+
+	for (size_t i = 0; i < boxes.paddedCount(); i += 4) {
+		__m128 cx = _mm_min_ps(_mm_max_ps(px, _mm_loadu_ps(&boxes.min_x[i])), _mm_loadu_ps(&boxes.max_x[i]));
+		__m128 cy = _mm_min_ps(_mm_max_ps(py, _mm_loadu_ps(&boxes.min_y[i])), _mm_loadu_ps(&boxes.max_y[i]));
+		__m128 cz = _mm_min_ps(_mm_max_ps(pz, _mm_loadu_ps(&boxes.min_z[i])), _mm_loadu_ps(&boxes.max_z[i]));
+
+		__m128 dx = _mm_sub_ps(cx, px);
+		__m128 dy = _mm_sub_ps(cy, py);
+		__m128 dz = _mm_sub_ps(cz, pz);
+		__m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		int mask = _mm_movemask_ps(_mm_cmple_ps(squared, squared_radius));
+
+		if (mask == 0) {
+			continue;
+		}
+
+		_mm_store_ps(closest_x, cx);
+		_mm_store_ps(closest_y, cy);
+		_mm_store_ps(closest_z, cz);
+
+		while (mask != 0) {
+			int lane = util::countTrailingZeros(static_cast<uint32_t>(mask));
+			mask &= mask - 1;
+
+			out_hit_indices[hit_count] = static_cast<uint32_t>(i + lane);
+			out_closest_points[hit_count] = glm::vec3(closest_x[lane], closest_y[lane], closest_z[lane]);
+			hit_count++;
+		}
+	}
+
+	return hit_count;
+}
+
+// the corner furthest along each plane's normal is the same for every box, so
+// it's picked once per plane instead of per box
+static size_t frustumVsAABBsSSE(
+		const Frustum& frustum,
+		const AABBBatch& boxes,
+		uint32_t* out_visible_indices) {
+	size_t visible_count = 0;
+
+	for (size_t i = 0; i < boxes.paddedCount(); i += 4) {
+		int mask = 0xf;
+
+		for (const glm::vec4& plane : frustum.planes) {
+			__m128 x = _mm_loadu_ps(plane.x >= 0.0f ? &boxes.max_x[i] : &boxes.min_x[i]);
+			__m128 y = _mm_loadu_ps(plane.y >= 0.0f ? &boxes.max_y[i] : &boxes.min_y[i]);
+			__m128 z = _mm_loadu_ps(plane.z >= 0.0f ? &boxes.max_z[i] : &boxes.min_z[i]);
+
+			__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			mask &= _mm_movemask_ps(_mm_cmpge_ps(distance, _mm_setzero_ps()));
+
+			if (mask == 0) {
+				break;
+			}
+		}
+
+		while (mask != 0) {
+			int lane = util::countTrailingZeros(static_cast<uint32_t>(mask));
+			mask &= mask - 1;
+
+			if (i + lane < boxes.count) {
+				out_visible_indices[visible_count++] = static_cast<uint32_t>(i + lane);
+			}
+		}
+	}
+
+	return visible_count;
+}
+
+// 4 rays at a time against one box
+static uint64_t raysVsAABBSSE(
+		const RayPacket& rays,
+		const size_t first,
+		const size_t count,
+		const AABB& box,
+		const uint64_t active_mask,
+		const float* t_max,
+		float* out_t_enter) {
+	__m128 min_x = _mm_set1_ps(box.min_pos.x);
+	__m128 min_y = _mm_set1_ps(box.min_pos.y);
+	__m128 min_z = _mm_set1_ps(box.min_pos.z);
+	__m128 max_x = _mm_set1_ps(box.max_pos.x);
+	__m128 max_y = _mm_set1_ps(box.max_pos.y);
+	__m128 max_z = _mm_set1_ps(box.max_pos.z);
+	__m128 zero = _mm_setzero_ps();
+	uint64_t mask = 0;
+
+	for (size_t i = first; i < first + count; i += 4) {
+		if (((active_mask >> (i - first)) & 0xf) == 0) {
+			continue;
+		}
+
+		__m128 origin_x = _mm_loadu_ps(&rays.origin_x[i]);
+		__m128 origin_y = _mm_loadu_ps(&rays.origin_y[i]);
+		__m128 origin_z = _mm_loadu_ps(&rays.origin_z[i]);
+		__m128 inv_x = _mm_loadu_ps(&rays.inv_direction_x[i]);
+		__m128 inv_y = _mm_loadu_ps(&rays.inv_direction_y[i]);
+		__m128 inv_z = _mm_loadu_ps(&rays.inv_direction_z[i]);
+
+		__m128 t1_x = _mm_mul_ps(_mm_sub_ps(min_x, origin_x), inv_x);
+		__m128 t2_x = _mm_mul_ps(_mm_sub_ps(max_x, origin_x), inv_x);
+		__m128 t1_y = _mm_mul_ps(_mm_sub_ps(min_y, origin_y), inv_y);
+		__m128 t2_y = _mm_mul_ps(_mm_sub_ps(max_y, origin_y), inv_y);
+		__m128 t1_z = _mm_mul_ps(_mm_sub_ps(min_z, origin_z), inv_z);
+		__m128 t2_z = _mm_mul_ps(_mm_sub_ps(max_z, origin_z), inv_z);
+
+		__m128 t_enter = _mm_max_ps(
+				_mm_max_ps(_mm_min_ps(t1_x, t2_x), _mm_min_ps(t1_y, t2_y)),
+				_mm_max_ps(_mm_min_ps(t1_z, t2_z), zero));
+		__m128 t_exit = _mm_min_ps(
+				_mm_min_ps(_mm_max_ps(t1_x, t2_x), _mm_max_ps(t1_y, t2_y)),
+				_mm_min_ps(_mm_max_ps(t1_z, t2_z), _mm_loadu_ps(t_max + i)));
+
+		_mm_storeu_ps(out_t_enter + i, t_enter);
+		uint64_t lanes = static_cast<uint64_t>(_mm_movemask_ps(_mm_cmple_ps(t_enter, t_exit)));
+		mask |= lanes << (i - first);
+	}
+
+	return mask & active_mask;
+}
+
+
+// ****************************************************************************
+// AVX2, 8 boxes at a time
+// ****************************************************************************
+SEVERIN_TARGET_AVX2
+static void squaredDistancesAVX2(const glm::vec3& point, const AABBBatch& boxes, float* out) {
+	__m256 px = _mm256_set1_ps(point.x);
+	__m256 py = _mm256_set1_ps(point.y);
+	__m256 pz = _mm256_set1_ps(point.z);
+
+	for (size_t i = 0; i < boxes.paddedCount(); i += 8) {
+		__m256 dx = _mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(px, _mm256_loadu_ps(&boxes.min_x[i])), _mm256_loadu_ps(&boxes.max_x[i])), px);
+		__m256 dy = _mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(py, _mm256_loadu_ps(&boxes.min_y[i])), _mm256_loadu_ps(&boxes.max_y[i])), py);
+		__m256 dz = _mm256_sub_ps(_mm256_min_ps(_mm256_max_ps(pz, _mm256_loadu_ps(&boxes.min_z[i])), _mm256_loadu_ps(&boxes.max_z[i])), pz);
+
+		__m256 squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		_mm256_storeu_ps(out + i, squared);
+	}
+}
+
+SEVERIN_TARGET_AVX2
+static void closestPointsAVX2(
+		const glm::vec3& point,
+		const AABBBatch& boxes,
+		float* out_x,
+		float* out_y,
+		float* out_z) {
+	__m256 px = _mm256_set1_ps(point.x);
+	__m256 py = _mm256_set1_ps(point.y);
+	__m256 pz = _mm256_set1_ps(point.z);
+
+	for (size_t i = 0; i < boxes.paddedCount(); i += 8) {
+		_mm256_storeu_ps(out_x + i, _mm256_min_ps(_mm256_max_ps(px, _mm256_loadu_ps(&boxes.min_x[i])), _mm256_loadu_ps(&boxes.max_x[i])));
+		_mm256_storeu_ps(out_y + i, _mm256_min_ps(_mm256_max_ps(py, _mm256_loadu_ps(&boxes.min_y[i])), _mm256_loadu_ps(&boxes.max_y[i])));
+		_mm256_storeu_ps(out_z + i, _mm256_min_ps(_mm256_max_ps(pz, _mm256_loadu_ps(&boxes.min_z[i])), _mm256_loadu_ps(&boxes.max_z[i])));
+	}
+}
+
+SEVERIN_TARGET_AVX2
+static size_t sphereVsAABBsAVX2(
+		const glm::vec3& center,
+		const float radius,
+		const AABBBatch& boxes,
+		uint32_t* out_hit_indices,
+		glm::vec3* out_closest_points) {
+	__m256 px = _mm256_set1_ps(center.x);
+	__m256 py = _mm256_set1_ps(center.y);
+	__m256 pz = _mm256_set1_ps(center.z);
+	__m256 squared_radius = _mm256_set1_ps(radius * radius);
+	size_t hit_count = 0;
+
+	alignas(32) float closest_x[8];
+	alignas(32) float closest_y[8];
+	alignas(32) float closest_z[8];
+
+	for (size_t i = 0; i < boxes.paddedCount(); i += 8) {
+		__m256 cx = _mm256_min_ps(_mm256_max_ps(px, _mm256_loadu_ps(&boxes.min_x[i])), _mm256_loadu_ps(&boxes.max_x[i]));
+		__m256 cy = _mm256_min_ps(_mm256_max_ps(py, _mm256_loadu_ps(&boxes.min_y[i])), _mm256_loadu_ps(&boxes.max_y[i]));
+		__m256 cz = _mm256_min_ps(_mm256_max_ps(pz, _mm256_loadu_ps(&boxes.min_z[i])), _mm256_loadu_ps(&boxes.max_z[i]));
+
+		__m256 dx = _mm256_sub_ps(cx, px);
+		__m256 dy = _mm256_sub_ps(cy, py);
+		__m256 dz = _mm256_sub_ps(cz, pz);
+		__m256 squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(squared, squared_radius, _CMP_LE_OQ));
+
+		if (mask == 0) {
+			continue;
+		}
+
+		_mm256_store_ps(closest_x, cx);
+		_mm256_store_ps(closest_y, cy);
+		_mm256_store_ps(closest_z, cz);
+
+		while (mask != 0) {
+			int lane = util::countTrailingZeros(static_cast<uint32_t>(mask));
+			mask &= mask - 1;
+
+			out_hit_indices[hit_count] = static_cast<uint32_t>(i + lane);
+			out_closest_points[hit_count] = glm::vec3(closest_x[lane], closest_y[lane], closest_z[lane]);
+			hit_count++;
+		}
+	}
+
+	return hit_count;
+}
+
+SEVERIN_TARGET_AVX2
+static size_t frustumVsAABBsAVX2(
+		const Frustum& frustum,
+		const AABBBatch& boxes,
+		uint32_t* out_visible_indices) {
+	size_t visible_count = 0;
+
+	for (size_t i = 0; i < boxes.paddedCount(); i += 8) {
+		int mask = 0xff;
+
+		for (const glm::vec4& plane : frustum.planes) {
+			__m256 x = _mm256_loadu_ps(plane.x >= 0.0f ? &boxes.max_x[i] : &boxes.min_x[i]);
+			__m256 y = _mm256_loadu_ps(plane.y >= 0.0f ? &boxes.max_y[i] : &boxes.min_y[i]);
+			__m256 z = _mm256_loadu_ps(plane.z >= 0.0f ? &boxes.max_z[i] : &boxes.min_z[i]);
+
+			__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+					_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+			mask &= _mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+
+			if (mask == 0) {
+				break;
+			}
+		}
+
+		while (mask != 0) {
+			int lane = util::countTrailingZeros(static_cast<uint32_t>(mask));
+			mask &= mask - 1;
+
+			if (i + lane < boxes.count) {
+				out_visible_indices[visible_count++] = static_cast<uint32_t>(i + lane);
+			}
+		}
+	}
+
+	return visible_count;
+}
+
+// 8 rays at a time against one box
+SEVERIN_TARGET_AVX2
+static uint64_t raysVsAABBAVX2(
+		const RayPacket& rays,
+		const size_t first,
+		const size_t count,
+		const AABB& box,
+		const uint64_t active_mask,
+		const float* t_max,
+		float* out_t_enter) {
+	__m256 min_x = _mm256_set1_ps(box.min_pos.x);
+	__m256 min_y = _mm256_set1_ps(box.min_pos.y);
+	__m256 min_z = _mm256_set1_ps(box.min_pos.z);
+	__m256 max_x = _mm256_set1_ps(box.max_pos.x);
+	__m256 max_y = _mm256_set1_ps(box.max_pos.y);
+	__m256 max_z = _mm256_set1_ps(box.max_pos.z);
+	__m256 zero = _mm256_setzero_ps();
+	uint64_t mask = 0;
+
+	for (size_t i = first; i < first + count; i += 8) {
+		if (((active_mask >> (i - first)) & 0xff) == 0) {
+			continue;
+		}
+
+		__m256 origin_x = _mm256_loadu_ps(&rays.origin_x[i]);
+		__m256 origin_y = _mm256_loadu_ps(&rays.origin_y[i]);
+		__m256 origin_z = _mm256_loadu_ps(&rays.origin_z[i]);
+		__m256 inv_x = _mm256_loadu_ps(&rays.inv_direction_x[i]);
+		__m256 inv_y = _mm256_loadu_ps(&rays.inv_direction_y[i]);
+		__m256 inv_z = _mm256_loadu_ps(&rays.inv_direction_z[i]);
+
+		__m256 t1_x = _mm256_mul_ps(_mm256_sub_ps(min_x, origin_x), inv_x);
+		__m256 t2_x = _mm256_mul_ps(_mm256_sub_ps(max_x, origin_x), inv_x);
+		__m256 t1_y = _mm256_mul_ps(_mm256_sub_ps(min_y, origin_y), inv_y);
+		__m256 t2_y = _mm256_mul_ps(_mm256_sub_ps(max_y, origin_y), inv_y);
+		__m256 t1_z = _mm256_mul_ps(_mm256_sub_ps(min_z, origin_z), inv_z);
+		__m256 t2_z = _mm256_mul_ps(_mm256_sub_ps(max_z, origin_z), inv_z);
+
+		__m256 t_enter = _mm256_max_ps(
+				_mm256_max_ps(_mm256_min_ps(t1_x, t2_x), _mm256_min_ps(t1_y, t2_y)),
+				_mm256_max_ps(_mm256_min_ps(t1_z, t2_z), zero));
+		__m256 t_exit = _mm256_min_ps(
+				_mm256_min_ps(_mm256_max_ps(t1_x, t2_x), _mm256_max_ps(t1_y, t2_y)),
+				_mm256_min_ps(_mm256_max_ps(t1_z, t2_z), _mm256_loadu_ps(t_max + i)));
+
+		_mm256_storeu_ps(out_t_enter + i, t_enter);
+		uint64_t lanes = static_cast<uint64_t>(_mm256_movemask_ps(_mm256_cmp_ps(t_enter, t_exit, _CMP_LE_OQ)));
+		mask |= lanes << (i - first);
+	}
+
+	return mask & active_mask;
+}
+
+
+static bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+
+	if (info[0] < 7) {
+		return false;
+	}
+
+	__cpuid(info, 1);
+	bool has_osxsave = (info[2] & (1 << 27)) != 0;
+	bool has_avx = (info[2] & (1 << 28)) != 0;
+
+	if (!has_osxsave || !has_avx) {
+		return false;
+	}
+
+	// make sure the OS saves the upper halves of the ymm registers
+	if ((_xgetbv(0) & 0x6) != 0x6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // SEVERIN_SIMD_X86
+
+
+struct KernelTable {
+	simd::Level level;
+	void (*squared_distances)(const glm::vec3&, const AABBBatch&, float*);
+	void (*closest_points)(const glm::vec3&, const AABBBatch&, float*, float*, float*);
+	size_t (*sphere_vs_aabbs)(const glm::vec3&, const float, const AABBBatch&, uint32_t*, glm::vec3*);
+	uint64_t (*rays_vs_aabb)(const RayPacket&, const size_t, const size_t, const AABB&, const uint64_t, const float*, float*);
+	size_t (*frustum_vs_aabbs)(const Frustum&, const AABBBatch&, uint32_t*);
+};
+
+static KernelTable kernelsForLevel(const simd::Level level) {
+#if SEVERIN_SIMD_X86
+	if (level == simd::Level::avx2 && cpuSupportsAVX2()) {
+		return {simd::Level::avx2, squaredDistancesAVX2, closestPointsAVX2, sphereVsAABBsAVX2, raysVsAABBAVX2, frustumVsAABBsAVX2};
+	}
+
+	if (level != simd::Level::scalar) {
+		// every x86-64 CPU has SSE2
+		return {simd::Level::sse, squaredDistancesSSE, closestPointsSSE, sphereVsAABBsSSE, raysVsAABBSSE, frustumVsAABBsSSE};
+	}
+#endif
+
+	return {simd::Level::scalar, squaredDistancesScalar, closestPointsScalar, sphereVsAABBsScalar, raysVsAABBScalar, frustumVsAABBsScalar};
+}
+
+static KernelTable& getKernels() {
+	static KernelTable kernels = kernelsForLevel(simd::Level::avx2);
+	return kernels;
+}
+
+
+void simd::setLevel(const Level level) {
+	getKernels() = kernelsForLevel(level);
+}
+
+const simd::Level simd::getLevel() {
+	return getKernels().level;
+}
+
+const char* simd::getLevelName() {
+	switch (getLevel()) {
+		case Level::avx2:
+			return "AVX2";
+		case Level::sse:
+			return "SSE";
+		default:
+			return "scalar";
+	}
+}
+
+void simd::squaredDistancesToAABBs(
+		const glm::vec3& point,
+		const AABBBatch& boxes,
+		float* out_squared_distances) {
+	getKernels().squared_distances(point, boxes, out_squared_distances);
+}
+
+void simd::closestPointsToAABBs(
+		const glm::vec3& point,
+		const AABBBatch& boxes,
+		float* out_x,
+		float* out_y,
+		float* out_z) {
+	getKernels().closest_points(point, boxes, out_x, out_y, out_z);
+}
+
+size_t simd::sphereVsAABBs(
+		const glm::vec3& center,
+		const float radius,
+		const AABBBatch& boxes,
+		uint32_t* out_hit_indices,
+		glm::vec3* out_closest_points) {
+	return getKernels().sphere_vs_aabbs(center, radius, boxes, out_hit_indices, out_closest_points);
+}
+
+uint64_t simd::raysVsAABB(
+		const RayPacket& rays,
+		const size_t first,
+		const size_t count,
+		const AABB& box,
+		const uint64_t active_mask,
+		const float* t_max,
+		float* out_t_enter) {
+	return getKernels().rays_vs_aabb(rays, first, count, box, active_mask, t_max, out_t_enter);
+}
+
+size_t simd::frustumVsAABBs(
+		const Frustum& frustum,
+		const AABBBatch& boxes,
+		uint32_t* out_visible_indices) {
+	return getKernels().frustum_vs_aabbs(frustum, boxes, out_visible_indices);
+}
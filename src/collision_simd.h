@@ -0,0 +1,140 @@
+#pragma once
+
+#include <collision.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// a bunch of AABBs stored as a structure of arrays, so one sphere can be
+// tested against 4 (SSE) or 8 (AVX2) of them at a time
+// the arrays are padded out to a multiple of kPadding with boxes that can
+// never be hit, so kernels never need a scalar tail
+struct AABBBatch {
+	static constexpr size_t kPadding = 8;
+
+	std::vector<float> min_x;
+	std::vector<float> min_y;
+	std::vector<float> min_z;
+	std::vector<float> max_x;
+	std::vector<float> max_y;
+	std::vector<float> max_z;
+	size_t count = 0;
+
+	void clear();
+	void add(const AABB& box);
+	void reserve(size_t box_count);
+
+	const size_t paddedCount() const {
+		return min_x.size();
+	}
+
+	const AABB getBox(size_t index) const {
+		return AABB{
+				glm::vec3(min_x[index], min_y[index], min_z[index]),
+				glm::vec3(max_x[index], max_y[index], max_z[index])};
+	}
+};
+
+
+// a bunch of rays stored as a structure of arrays, with their reciprocal
+// directions precomputed
+// padded out to a multiple of kPadding like AABBBatch
+struct RayPacket {
+	static constexpr size_t kPadding = 8;
+
+	std::vector<float> origin_x;
+	std::vector<float> origin_y;
+	std::vector<float> origin_z;
+	std::vector<float> direction_x;
+	std::vector<float> direction_y;
+	std::vector<float> direction_z;
+	std::vector<float> inv_direction_x;
+	std::vector<float> inv_direction_y;
+	std::vector<float> inv_direction_z;
+	size_t count = 0;
+
+	void clear();
+	void add(const Ray& ray);
+
+	const size_t paddedCount() const {
+		return origin_x.size();
+	}
+
+	const Ray getRay(size_t index) const {
+		return Ray{
+				glm::vec3(origin_x[index], origin_y[index], origin_z[index]),
+				glm::vec3(direction_x[index], direction_y[index], direction_z[index])};
+	}
+};
+
+
+// batched versions of the collision.h helpers
+// the widest instruction set the CPU supports is picked the first time any of
+// these are called, with the plain scalar functions as the fallback
+namespace simd {
+	enum class Level {
+		scalar,
+		sse,
+		avx2
+	};
+
+	const Level getLevel();
+	const char* getLevelName();
+
+	// force a narrower level, e.g. to compare against the scalar path
+	// asking for something the CPU can't do gets the next best thing
+	void setLevel(const Level level);
+
+	// squaredDistanceToAABB for every box, out needs room for boxes.paddedCount()
+	void squaredDistancesToAABBs(
+			const glm::vec3& point,
+			const AABBBatch& boxes,
+			float* out_squared_distances);
+
+	// closestPointToAABB for every box, each output array needs room for
+	// boxes.paddedCount()
+	void closestPointsToAABBs(
+			const glm::vec3& point,
+			const AABBBatch& boxes,
+			float* out_x,
+			float* out_y,
+			float* out_z);
+
+	// Collision::sphereVsAABB for every box
+	// writes the index and closest point of each box the sphere touches (in
+	// ascending order), returns how many there were
+	// each output array needs room for boxes.count
+	size_t sphereVsAABBs(
+			const glm::vec3& center,
+			const float radius,
+			const AABBBatch& boxes,
+			uint32_t* out_hit_indices,
+			glm::vec3* out_closest_points);
+
+	// frustumOverlapsAABB for every box
+	// writes the index of each box at least partly inside the frustum (in
+	// ascending order), returns how many there were
+	// out_visible_indices needs room for boxes.count
+	size_t frustumVsAABBs(
+			const Frustum& frustum,
+			const AABBBatch& boxes,
+			uint32_t* out_visible_indices);
+
+	// rayAABBInverse for up to 64 rays of the packet (starting at first, which
+	// must be a multiple of RayPacket::kPadding) against one box
+	// bit i of the masks stands for ray (first + i); rays not in active_mask are
+	// skipped, and whole groups of them don't get tested at all
+	// t_max and out_t_enter are indexed the same as the packet's rays
+	// returns the active rays that hit within their t_max
+	uint64_t raysVsAABB(
+			const RayPacket& rays,
+			const size_t first,
+			const size_t count,
+			const AABB& box,
+			const uint64_t active_mask,
+			const float* t_max,
+			float* out_t_enter);
+}
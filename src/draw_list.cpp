@@ -0,0 +1,102 @@
+#include <draw_list.h>
+
+#include <scene.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+// the box around box once it's been through transform
+// real time collision detection pg. 86
+static const AABB transformAABB(const glm::mat4& transform, const AABB& box) {
+	glm::vec3 center = (box.min_pos + box.max_pos) * 0.5f;
+	glm::vec3 half_extents = (box.max_pos - box.min_pos) * 0.5f;
+
+	glm::vec3 new_center = glm::vec3(transform * glm::vec4(center, 1.0f));
+	glm::vec3 new_half_extents(0.0f);
+
+	for (int column = 0; column < 3; column++) {
+		new_half_extents += glm::abs(glm::vec3(transform[column])) * half_extents[column];
+	}
+
+	return AABB{new_center - new_half_extents, new_center + new_half_extents};
+}
+
+
+void DrawList::setMeshBounds(const ModelID mesh_id, const Model& model) {
+	if (mesh_id >= mesh_bounds.size()) {
+		// anything without bounds yet can't be culled
+		constexpr float kMax = std::numeric_limits<float>::max();
+		mesh_bounds.resize(mesh_id + 1, AABB{glm::vec3(-kMax), glm::vec3(kMax)});
+	}
+
+	if (model.vertices.empty()) {
+		return;
+	}
+
+	AABB bounds{model.vertices[0].position, model.vertices[0].position};
+
+	for (const Vertex& vertex : model.vertices) {
+		bounds.min_pos = glm::min(bounds.min_pos, vertex.position);
+		bounds.max_pos = glm::max(bounds.max_pos, vertex.position);
+	}
+
+	mesh_bounds[mesh_id] = bounds;
+}
+
+void DrawList::build(const Scene& scene) {
+	entities.clear();
+	world_bounds.clear();
+	packets.clear();
+	instance_objects.clear();
+	batches.clear();
+
+	constexpr float kMax = std::numeric_limits<float>::max();
+	const AABB kUnbounded{glm::vec3(-kMax), glm::vec3(kMax)};
+
+	for (int i = 0; const Entity* entity = scene.getNextEntity(i); i++) {
+		entities.push_back(entity);
+
+		if (entity->mesh_id < mesh_bounds.size() && mesh_bounds[entity->mesh_id].max_pos.x < kMax) {
+			world_bounds.add(transformAABB(entity->getModelMatrix(), mesh_bounds[entity->mesh_id]));
+		} else {
+			world_bounds.add(kUnbounded);
+		}
+	}
+
+	visible_indices.resize(entities.size());
+	size_t visible_count = simd::frustumVsAABBs(scene.camera.getFrustum(), world_bounds, visible_indices.data());
+	culled_count = entities.size() - visible_count;
+
+	// depth is the distance in front of the camera, i.e. -z in view space
+	glm::vec4 depth_row(
+			-scene.camera.view[0][2],
+			-scene.camera.view[1][2],
+			-scene.camera.view[2][2],
+			-scene.camera.view[3][2]);
+
+	for (size_t i = 0; i < visible_count; i++) {
+		uint32_t entity_index = visible_indices[i];
+		const Entity* entity = entities[entity_index];
+		glm::vec3 center = glm::vec3(entity->getModelMatrix()[3]);
+		float depth = glm::dot(depth_row, glm::vec4(center, 1.0f));
+
+		packets.push_back(DrawPacket{DrawPacket::makeSortKey(entity->mesh_id, entity->material_id, depth), entity_index});
+	}
+
+	std::sort(packets.begin(), packets.end());
+
+	for (const DrawPacket& packet : packets) {
+		const Entity* entity = entities[packet.entity_index];
+
+		if (batches.empty()
+				|| batches.back().mesh_id != entity->mesh_id
+				|| batches.back().material_id != entity->material_id) {
+			batches.push_back(DrawBatch{entity->mesh_id, entity->material_id, static_cast<uint32_t>(instance_objects.size()), 0});
+		}
+
+		batches.back().instance_count++;
+		instance_objects.push_back(packet.entity_index);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <collision.h>
+#include <collision_simd.h>
+#include <entity.h>
+#include <model.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+struct Scene;
+
+
+// instance_count entries in a row in DrawList::instance_objects, all with the
+// same mesh and material, drawn with one instanced call starting at
+// first_instance (the shaders find their object through gl_InstanceIndex)
+struct DrawBatch {
+	ModelID mesh_id;
+	uint16_t material_id;
+	uint32_t first_instance;
+	uint32_t instance_count;
+};
+
+
+// one visible entity, sorted by its key: mesh, then material (so each batch is
+// a contiguous run), then depth (so each batch draws front to back and the
+// depth test throws away more of what's behind)
+struct DrawPacket {
+	uint64_t sort_key;
+	uint32_t entity_index; // into DrawList::entities, and the object buffer
+
+	static const uint64_t makeSortKey(const ModelID mesh_id, const uint16_t material_id, const float depth) {
+		// positive floats sort the same as their bits
+		float clamped_depth = std::max(depth, 0.0f);
+		uint32_t depth_bits;
+		std::memcpy(&depth_bits, &clamped_depth, sizeof(depth_bits));
+
+		return (static_cast<uint64_t>(mesh_id) << 48) | (static_cast<uint64_t>(material_id) << 32) | depth_bits;
+	}
+
+	const bool operator<(const DrawPacket& other) const {
+		// the index breaks ties so the order doesn't shuffle between frames
+		return sort_key < other.sort_key || (sort_key == other.sort_key && entity_index < other.entity_index);
+	}
+};
+
+
+// everything the renderer draws this frame: entities outside the camera's
+// frustum are culled, the rest are sorted into packets, and each run of the
+// same mesh and material becomes a single instanced draw
+// every entity keeps its own slot in the object buffer (see ObjectBuffer), and
+// draws only upload which slots they use, so an object that didn't move never
+// gets written again however the sort order changes
+// rebuilt every frame, but keeps its storage around so that doesn't allocate
+struct DrawList {
+	std::vector<const Entity*> entities; // in object buffer order
+	std::vector<uint32_t> instance_objects; // object buffer slot per instance, in draw order
+	std::vector<DrawBatch> batches;
+	size_t culled_count = 0; // last build()
+
+	// per ModelID, in model space, see setMeshBounds()
+	std::vector<AABB> mesh_bounds;
+
+	// has to be called for every model uploaded, or entities using it never get
+	// culled
+	void setMeshBounds(const ModelID mesh_id, const Model& model);
+
+	// everything Scene::getNextEntity() hands out, as seen by the scene's camera
+	void build(const Scene& scene);
+
+	// scratch, kept so it doesn't get reallocated every frame
+	AABBBatch world_bounds; // per entity
+	std::vector<uint32_t> visible_indices;
+	std::vector<DrawPacket> packets;
+};
@@ -0,0 +1,430 @@
+#include <dynamic_tree.h>
+
+#include <util.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+static AABB combineBounds(const AABB& first, const AABB& second) {
+	return AABB{glm::min(first.min_pos, second.min_pos), glm::max(first.max_pos, second.max_pos)};
+}
+
+static float surfaceArea(const AABB& bounds) {
+	glm::vec3 extent = bounds.max_pos - bounds.min_pos;
+	return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+
+DynamicTreeProxy DynamicTree::allocateNode() {
+	if (free_list == kNullNode) {
+		nodes.emplace_back();
+		return static_cast<DynamicTreeProxy>(nodes.size() - 1);
+	}
+
+	DynamicTreeProxy node = free_list;
+	free_list = nodes[node].parent;
+	nodes[node] = DynamicTreeNode{};
+
+	return node;
+}
+
+void DynamicTree::freeNode(const DynamicTreeProxy node) {
+	nodes[node].parent = free_list;
+	nodes[node].height = -1;
+	free_list = node;
+}
+
+
+DynamicTreeProxy DynamicTree::createProxy(const AABB& bounds, const uint32_t user_data) {
+	DynamicTreeProxy proxy = allocateNode();
+	DynamicTreeNode& node = nodes[proxy];
+	node.bounds = AABB{bounds.min_pos - glm::vec3(kFatMargin), bounds.max_pos + glm::vec3(kFatMargin)};
+	node.user_data = user_data;
+
+	insertLeaf(proxy);
+	proxy_count++;
+
+	return proxy;
+}
+
+void DynamicTree::destroyProxy(const DynamicTreeProxy proxy) {
+	removeLeaf(proxy);
+	freeNode(proxy);
+	proxy_count--;
+}
+
+const bool DynamicTree::moveProxy(const DynamicTreeProxy proxy, const AABB& bounds, const glm::vec3& displacement) {
+	if (aabbContains(nodes[proxy].bounds, bounds)) {
+		return false;
+	}
+
+	// stretch towards where it's headed, so it stays inside for a few ticks
+	AABB fat_bounds{bounds.min_pos - glm::vec3(kFatMargin), bounds.max_pos + glm::vec3(kFatMargin)};
+	glm::vec3 stretch = displacement * kDisplacementMultiplier;
+	fat_bounds.min_pos += glm::min(stretch, glm::vec3(0.0f));
+	fat_bounds.max_pos += glm::max(stretch, glm::vec3(0.0f));
+
+	removeLeaf(proxy);
+	nodes[proxy].bounds = fat_bounds;
+	insertLeaf(proxy);
+
+	return true;
+}
+
+
+void DynamicTree::insertLeaf(const DynamicTreeProxy leaf) {
+	if (root == kNullNode) {
+		root = leaf;
+		nodes[root].parent = kNullNode;
+		return;
+	}
+
+	// walk down to the cheapest sibling, going by how much surface area each
+	// choice would add to the tree
+	const AABB leaf_bounds = nodes[leaf].bounds;
+	DynamicTreeProxy sibling = root;
+
+	while (!nodes[sibling].isLeaf()) {
+		const DynamicTreeNode& node = nodes[sibling];
+		float area = surfaceArea(node.bounds);
+		float combined_area = surfaceArea(combineBounds(node.bounds, leaf_bounds));
+
+		// pairing with this node makes a new parent with the combined area
+		float cost = 2.0f * combined_area;
+		// going further down grows this node (and everything above it) anyway
+		float inherited_cost = 2.0f * (combined_area - area);
+
+		float child_costs[2];
+		DynamicTreeProxy children[2] = {node.first_child, node.second_child};
+
+		for (int i = 0; i < 2; i++) {
+			const DynamicTreeNode& child = nodes[children[i]];
+			float child_combined_area = surfaceArea(combineBounds(child.bounds, leaf_bounds));
+
+			if (child.isLeaf()) {
+				child_costs[i] = child_combined_area + inherited_cost;
+			} else {
+				child_costs[i] = child_combined_area - surfaceArea(child.bounds) + inherited_cost;
+			}
+		}
+
+		if (cost < child_costs[0] && cost < child_costs[1]) {
+			break;
+		}
+
+		sibling = child_costs[0] < child_costs[1] ? children[0] : children[1];
+	}
+
+	// put a new parent in the sibling's place, with the sibling and the leaf
+	// under it
+	DynamicTreeProxy old_parent = nodes[sibling].parent;
+	DynamicTreeProxy new_parent = allocateNode();
+	DynamicTreeNode& parent_node = nodes[new_parent];
+	parent_node.parent = old_parent;
+	parent_node.bounds = combineBounds(leaf_bounds, nodes[sibling].bounds);
+	parent_node.height = nodes[sibling].height + 1;
+	parent_node.first_child = sibling;
+	parent_node.second_child = leaf;
+
+	if (old_parent == kNullNode) {
+		root = new_parent;
+	} else if (nodes[old_parent].first_child == sibling) {
+		nodes[old_parent].first_child = new_parent;
+	} else {
+		nodes[old_parent].second_child = new_parent;
+	}
+
+	nodes[sibling].parent = new_parent;
+	nodes[leaf].parent = new_parent;
+
+	refitAncestors(new_parent, true);
+}
+
+void DynamicTree::removeLeaf(const DynamicTreeProxy leaf) {
+	if (leaf == root) {
+		root = kNullNode;
+		return;
+	}
+
+	// the sibling takes the parent's place
+	DynamicTreeProxy parent = nodes[leaf].parent;
+	DynamicTreeProxy grandparent = nodes[parent].parent;
+	DynamicTreeProxy sibling =
+			nodes[parent].first_child == leaf ? nodes[parent].second_child : nodes[parent].first_child;
+
+	freeNode(parent);
+	nodes[sibling].parent = grandparent;
+
+	if (grandparent == kNullNode) {
+		root = sibling;
+		return;
+	}
+
+	if (nodes[grandparent].first_child == parent) {
+		nodes[grandparent].first_child = sibling;
+	} else {
+		nodes[grandparent].second_child = sibling;
+	}
+
+	refitAncestors(grandparent, false);
+}
+
+void DynamicTree::refitNode(const DynamicTreeProxy node) {
+	DynamicTreeNode& current = nodes[node];
+	const DynamicTreeNode& first = nodes[current.first_child];
+	const DynamicTreeNode& second = nodes[current.second_child];
+	current.height = 1 + std::max(first.height, second.height);
+	current.bounds = combineBounds(first.bounds, second.bounds);
+}
+
+void DynamicTree::refitAncestors(DynamicTreeProxy node, const bool should_rotate) {
+	bool is_first = true;
+
+	while (node != kNullNode) {
+		DynamicTreeNode& current = nodes[node];
+		int32_t old_height = current.height;
+		AABB old_bounds = current.bounds;
+
+		refitNode(node);
+		// rotating only shuffles what's under node, so its bounds stay the same
+		if (should_rotate && rotate(node)) {
+			refitNode(node);
+		}
+
+		// once a node comes out the same as it was, nothing above it can change
+		// (the first one always has a new child, so it doesn't count)
+		bool is_unchanged = current.height == old_height
+				&& current.bounds.min_pos == old_bounds.min_pos
+				&& current.bounds.max_pos == old_bounds.max_pos;
+
+		if (is_unchanged && !is_first) {
+			break;
+		}
+
+		is_first = false;
+		node = current.parent;
+	}
+}
+
+
+// the two nodes trade places, taking their subtrees with them
+// they can't share a parent, or be above one another
+void DynamicTree::swapNodes(const DynamicTreeProxy first, const DynamicTreeProxy second) {
+	DynamicTreeProxy first_parent = nodes[first].parent;
+	DynamicTreeProxy second_parent = nodes[second].parent;
+
+	if (nodes[first_parent].first_child == first) {
+		nodes[first_parent].first_child = second;
+	} else {
+		nodes[first_parent].second_child = second;
+	}
+
+	if (nodes[second_parent].first_child == second) {
+		nodes[second_parent].first_child = first;
+	} else {
+		nodes[second_parent].second_child = first;
+	}
+
+	nodes[first].parent = second_parent;
+	nodes[second].parent = first_parent;
+}
+
+// with b and c as a's children, and d, e and f, g as theirs, swaps a child of
+// a with one of its grandchildren on the other side (or two grandchildren)
+// if that shrinks the surface area of b and c
+// this keeps the tree tight the way a fresh top down build would, which
+// matters more for queries than keeping it strictly balanced by height
+const bool DynamicTree::rotate(const DynamicTreeProxy a) {
+	if (nodes[a].height < 2) {
+		return false;
+	}
+
+	DynamicTreeProxy b = nodes[a].first_child;
+	DynamicTreeProxy c = nodes[a].second_child;
+	const DynamicTreeNode& node_b = nodes[b];
+	const DynamicTreeNode& node_c = nodes[c];
+	float area_b = surfaceArea(node_b.bounds);
+	float area_c = surfaceArea(node_c.bounds);
+
+	// best swap found so far, and how much area it saves
+	DynamicTreeProxy swap_first = kNullNode;
+	DynamicTreeProxy swap_second = kNullNode;
+	float best_saving = 0.0f;
+
+	auto consider = [&](const DynamicTreeProxy first, const DynamicTreeProxy second, const float saving) {
+		if (saving > best_saving) {
+			swap_first = first;
+			swap_second = second;
+			best_saving = saving;
+		}
+	};
+
+	if (!node_c.isLeaf()) {
+		DynamicTreeProxy f = node_c.first_child;
+		DynamicTreeProxy g = node_c.second_child;
+
+		// b and f (or g) trade places, c ends up around whatever is left with b
+		consider(b, f, area_c - surfaceArea(combineBounds(node_b.bounds, nodes[g].bounds)));
+		consider(b, g, area_c - surfaceArea(combineBounds(node_b.bounds, nodes[f].bounds)));
+	}
+
+	if (!node_b.isLeaf()) {
+		DynamicTreeProxy d = node_b.first_child;
+		DynamicTreeProxy e = node_b.second_child;
+
+		consider(c, d, area_b - surfaceArea(combineBounds(node_c.bounds, nodes[e].bounds)));
+		consider(c, e, area_b - surfaceArea(combineBounds(node_c.bounds, nodes[d].bounds)));
+
+		if (!node_c.isLeaf()) {
+			DynamicTreeProxy f = node_c.first_child;
+			DynamicTreeProxy g = node_c.second_child;
+			const AABB& bounds_d = nodes[d].bounds;
+			const AABB& bounds_e = nodes[e].bounds;
+			const AABB& bounds_f = nodes[f].bounds;
+			const AABB& bounds_g = nodes[g].bounds;
+			float area_both = area_b + area_c;
+
+			consider(d, f, area_both - surfaceArea(combineBounds(bounds_f, bounds_e)) - surfaceArea(combineBounds(bounds_d, bounds_g)));
+			consider(d, g, area_both - surfaceArea(combineBounds(bounds_g, bounds_e)) - surfaceArea(combineBounds(bounds_f, bounds_d)));
+		}
+	}
+
+	if (swap_first == kNullNode) {
+		return false;
+	}
+
+	DynamicTreeProxy first_parent = nodes[swap_first].parent;
+	DynamicTreeProxy second_parent = nodes[swap_second].parent;
+
+	swapNodes(swap_first, swap_second);
+
+	// refit whichever of b and c changed (a is left to the caller)
+	if (first_parent != a) {
+		refitNode(first_parent);
+	}
+
+	if (second_parent != a) {
+		refitNode(second_parent);
+	}
+
+	return true;
+}
+
+
+void DynamicTree::collectOverlaps(
+		const OverlapQuery* queries,
+		const size_t query_count,
+		const std::vector<SphereCollider>& colliders,
+		OverlapResults* results) const {
+	if (root == kNullNode) {
+		return;
+	}
+
+	for (size_t chunk_start = 0; chunk_start < query_count; chunk_start += kOverlapChunkSize) {
+		size_t chunk_count = std::min(kOverlapChunkSize, query_count - chunk_start);
+		uint64_t chunk_mask = 0;
+
+		for (size_t i = 0; i < chunk_count; i++) {
+			if (queries[chunk_start + i].include_dynamic) {
+				chunk_mask |= uint64_t(1) << i;
+			}
+		}
+
+		struct StackEntry {
+			DynamicTreeProxy node;
+			uint64_t query_mask;
+		};
+
+		StackEntry stack[kMaxQueryStack];
+		int stack_size = 0;
+
+		if (chunk_mask != 0) {
+			stack[stack_size++] = {root, chunk_mask};
+		}
+
+		while (stack_size > 0) {
+			StackEntry entry = stack[--stack_size];
+			const DynamicTreeNode& node = nodes[entry.node];
+			uint64_t active_mask = 0;
+
+			for (uint64_t mask = entry.query_mask; mask != 0; mask &= mask - 1) {
+				int bit = util::countTrailingZeros64(mask);
+
+				if (queries[chunk_start + bit].overlaps(node.bounds)) {
+					active_mask |= uint64_t(1) << bit;
+				}
+			}
+
+			if (active_mask == 0) {
+				continue;
+			}
+
+			if (!node.isLeaf()) {
+				if (stack_size + 2 <= kMaxQueryStack) {
+					stack[stack_size++] = {node.first_child, active_mask};
+					stack[stack_size++] = {node.second_child, active_mask};
+				}
+
+				continue;
+			}
+
+			// the leaf's box is fattened, so check the actual sphere
+			const SphereCollider& collider = colliders[node.user_data];
+
+			for (uint64_t mask = active_mask; mask != 0; mask &= mask - 1) {
+				int bit = util::countTrailingZeros64(mask);
+				const OverlapQuery& query = queries[chunk_start + bit];
+
+				if ((query.dynamic_layer_mask & collider.layer) && query.overlaps(collider.sphere)) {
+					results[chunk_start + bit].add(OverlapHit::Kind::dynamic_entity, static_cast<uint16_t>(node.user_data));
+				}
+			}
+		}
+	}
+}
+
+
+void DynamicTree::update(
+		const std::vector<SphereCollider>& colliders,
+		const std::vector<RigidBody>& bodies,
+		const std::vector<glm::vec3>& previous_positions) {
+	reinsert_count = 0;
+
+	// new entities always go on the end (removals go through remove())
+	for (size_t i = entity_proxies.size(); i < colliders.size(); i++) {
+		entity_proxies.push_back(kNullNode);
+	}
+
+	for (size_t i = 0; i < colliders.size(); i++) {
+		AABB bounds = colliders[i].getBounds();
+
+		if (entity_proxies[i] == kNullNode) {
+			entity_proxies[i] = createProxy(bounds, static_cast<uint32_t>(i));
+		} else if (moveProxy(entity_proxies[i], bounds, bodies[i].position - previous_positions[i])) {
+			reinsert_count++;
+		}
+	}
+}
+
+void DynamicTree::remove(const DynamicEntityIndex removed_index, const DynamicEntityIndex moved_from_index) {
+	if (removed_index < entity_proxies.size() && entity_proxies[removed_index] != kNullNode) {
+		destroyProxy(entity_proxies[removed_index]);
+		entity_proxies[removed_index] = kNullNode;
+	}
+
+	// if the entity that moved was added since the last update, its new spot
+	// is left null and gets a proxy on the next one
+	if (moved_from_index < entity_proxies.size()) {
+		if (moved_from_index != removed_index) {
+			DynamicTreeProxy moved_proxy = entity_proxies[moved_from_index];
+			entity_proxies[removed_index] = moved_proxy;
+
+			if (moved_proxy != kNullNode) {
+				nodes[moved_proxy].user_data = removed_index;
+			}
+		}
+
+		entity_proxies.pop_back();
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <collision.h>
+#include <entity.h>
+#include <overlap_query.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+using DynamicTreeProxy = int32_t;
+
+
+struct DynamicTreeNode {
+	static constexpr DynamicTreeProxy kNullNode = -1;
+
+	AABB bounds; // fattened, for leaves
+	DynamicTreeProxy parent = kNullNode; // or the next free node, once freed
+	DynamicTreeProxy first_child = kNullNode;
+	DynamicTreeProxy second_child = kNullNode;
+	int32_t height = 0; // 0 for leaves, -1 once freed
+	uint32_t user_data = 0;
+
+	const bool isLeaf() const {
+		return first_child == kNullNode;
+	}
+};
+
+
+// bounding volume tree for things that move every tick, kept up to date
+// incrementally instead of being rebuilt (as opposed to StaticBVH)
+// each leaf's box is fattened by a margin and stretched along the way it's
+// moving, so most moves stay inside it and cost nothing; anything that gets
+// out is pulled out of the tree and inserted again where it's cheapest by
+// surface area
+// every insert and remove rotates nodes on the way back up to keep the tree
+// balanced (by surface area, see rotate()), so queries stay logarithmic
+// however things move around
+//
+// the proxy functions can be used for anything, update() and remove() keep a
+// proxy per dynamic entity, with the entity index as the user data
+struct DynamicTree {
+	static constexpr DynamicTreeProxy kNullNode = DynamicTreeNode::kNullNode;
+	static constexpr float kFatMargin = 0.2f; // meters, on every side
+	// how many ticks worth of movement to stretch the box by (a bit over 60 ms)
+	static constexpr float kDisplacementMultiplier = 8.0f;
+	// the stack only gets as deep as the tree, which stays far shallower than this
+	// for any number of entities we can hold
+	static constexpr int kMaxQueryStack = 256;
+
+	std::vector<DynamicTreeNode> nodes;
+	DynamicTreeProxy root = kNullNode;
+	DynamicTreeProxy free_list = kNullNode;
+	size_t proxy_count = 0;
+	size_t reinsert_count = 0; // proxies that outgrew their fat box, since the last update()
+
+	std::vector<DynamicTreeProxy> entity_proxies; // per dynamic entity
+
+	DynamicTreeProxy createProxy(const AABB& bounds, const uint32_t user_data);
+	void destroyProxy(const DynamicTreeProxy proxy);
+
+	// returns true if bounds got outside the fat box and it had to be reinserted
+	// displacement is how far it moved this tick
+	const bool moveProxy(const DynamicTreeProxy proxy, const AABB& bounds, const glm::vec3& displacement);
+
+	const AABB& getFatBounds(const DynamicTreeProxy proxy) const {
+		return nodes[proxy].bounds;
+	}
+
+	const uint32_t getUserData(const DynamicTreeProxy proxy) const {
+		return nodes[proxy].user_data;
+	}
+
+	// calls visit(user_data) for every proxy whose fat box overlaps bounds, until
+	// visit returns false
+	// doesn't allocate, so this is fine to call from several threads at once
+	template <typename Visitor>
+	void query(const AABB& bounds, Visitor&& visit) const {
+		if (root == kNullNode) {
+			return;
+		}
+
+		DynamicTreeProxy stack[kMaxQueryStack];
+		int stack_size = 0;
+		stack[stack_size++] = root;
+
+		while (stack_size > 0) {
+			const DynamicTreeNode& node = nodes[stack[--stack_size]];
+
+			if (!aabbsOverlap(node.bounds, bounds)) {
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				if (!visit(node.user_data)) {
+					return;
+				}
+			} else if (stack_size + 2 <= kMaxQueryStack) {
+				stack[stack_size++] = node.first_child;
+				stack[stack_size++] = node.second_child;
+			}
+		}
+	}
+
+	// adds every dynamic entity whose collider overlaps queries[i] to results[i],
+	// for queries that include dynamic entities on that entity's layer
+	// only good for the entity proxies, see update()
+	void collectOverlaps(
+			const OverlapQuery* queries,
+			const size_t query_count,
+			const std::vector<SphereCollider>& colliders,
+			OverlapResults* results) const;
+
+	const int getHeight() const {
+		return root == kNullNode ? 0 : nodes[root].height;
+	}
+
+	// pull in new entities and move everyone else's proxies to their collider's
+	// bounds, previous_positions gives how far each one moved
+	void update(const std::vector<SphereCollider>& colliders, const std::vector<RigidBody>& bodies, const std::vector<glm::vec3>& previous_positions);
+
+	// for when the entity at removed_index is gone, and the one that was at
+	// moved_from_index took its place (see EntityManager::remove)
+	void remove(const DynamicEntityIndex removed_index, const DynamicEntityIndex moved_from_index);
+
+	DynamicTreeProxy allocateNode();
+	void freeNode(const DynamicTreeProxy node);
+	void insertLeaf(const DynamicTreeProxy leaf);
+	void removeLeaf(const DynamicTreeProxy leaf);
+	// recomputes bounds and height from the children
+	void refitNode(const DynamicTreeProxy node);
+	// walks up from node, refitting (and rotating, after an insert) every
+	// ancestor that changed
+	// removing only ever shrinks boxes, so it leaves the tree no worse and
+	// doesn't bother rotating
+	void refitAncestors(DynamicTreeProxy node, const bool should_rotate);
+	void swapNodes(const DynamicTreeProxy first, const DynamicTreeProxy second);
+	// returns true if anything under node moved
+	const bool rotate(const DynamicTreeProxy node);
+};
@@ -15,34 +15,44 @@ void Engine::setUpExperimentalGarbage() const {
 		glm::vec3 pos{5.0f, 1.5f, -5.0f};
 		float size = 2.0f;
 		glm::vec3 dims{size, size, size};
-		Model model = Model::createHexahedron(dims.x, dims.y, dims.z);
-		ModelID model_id = uploadModel(model);
+		ModelID model_id = uploadModel(Model::createHexahedron(1.0f, 1.0f, 1.0f));
 
-		Entity* ent = _scene->addStaticEntity(
+		StaticEntityID ent_id = _scene->addStaticEntity(
 				model_id,
 				_default_material_id,
 				pos,
-				AxisAngle{},
-				1.0f); // scale
-		ent->collision.type = Collision::Type::aabb;
-		ent->collision.shape.box.min_pos = pos - dims / 2.0f;
-		ent->collision.shape.box.max_pos = pos + dims / 2.0f;
+				util::kNoRotation,
+				size); // scale
+
+		if (ent_id.isValid()) {
+			Entity& ent = _scene->getStaticEntity(ent_id);
+			ent.collision.type = Collision::Type::aabb;
+			ent.collision.shape.box.min_pos = pos - dims / 2.0f;
+			ent.collision.shape.box.max_pos = pos + dims / 2.0f;
+		}
 	}
 
 
 	// **************************************************************************
 	// set up misc stuff
 	// **************************************************************************
-	// // add building model
-	// Model model = Model::createFromOBJ("assets/", "large_buildingE.obj");
-	// glm::vec3 building_pos{10.0f, 0.0f, -10.0f};
-	// ModelID model_id = uploadModel(model);
-	// _scene->addStaticEntity(
-	// 			model_id,
-	// 			_default_material_id,
-	// 			building_pos,
-	// 			AxisAngle{},
-	// 			1.0f); // scale
+	// add building model
+	{
+		Model model = Model::createFromOBJ("assets/", "large_buildingE.obj");
+		glm::vec3 building_pos{10.0f, 0.0f, -10.0f};
+		ModelID model_id = uploadModel(model);
+
+		StaticEntityID building_id = _scene->addStaticEntity(
+				model_id,
+				_default_material_id,
+				building_pos,
+				util::kNoRotation,
+				1.0f); // scale
+
+		if (building_id.isValid()) {
+			_scene->setMeshCollision(building_id, model);
+		}
+	}
 
 	// // add icosahedron model
 	// Model icosa_model = Model::createIcosahedron();
@@ -53,7 +63,7 @@ void Engine::setUpExperimentalGarbage() const {
 	// 			icosa_model_id,
 	// 			_default_material_id,
 	// 			icosa_pos,
-	// 			AxisAngle{},
+	// 			util::kNoRotation,
 	// 			1.0f); // scale
 	// // set up icosahedron collision
 	// ball_ent->collision.type = Collision::Type::sphere;
@@ -67,15 +77,14 @@ void Engine::setUpExperimentalGarbage() const {
 	glm::vec3 player_force_pointer_color{1.0f, 0.0f, 0.0f};
 	Model player_force_pointer_model = Model::createIcosahedron(player_force_pointer_color);
 	player_force_pointer_model = subdivide(player_force_pointer_model, player_force_pointer_color);
-	glm::vec3 player_force_pointer_pos = player.getEntity().position + player.eye_offset;
+	glm::vec3 player_force_pointer_pos = player.getBody().position + player.eye_offset;
 	ModelID player_force_pointer_model_id = uploadModel(player_force_pointer_model);
-	Entity* player_force_pointer_ent = _scene->addStaticEntity(
+	player.pointer_ent_id = _scene->addStaticEntity(
 				player_force_pointer_model_id,
 				_default_material_id,
 				player_force_pointer_pos,
-				AxisAngle{},
+				util::kNoRotation,
 				0.01f); // scale
-	player.pointer_ent_id = _scene->static_entities.size() - 1;
 
 	// set up the beam for the player beam gun
 	{
@@ -95,19 +104,19 @@ void Engine::setUpExperimentalGarbage() const {
 		glm::vec3 beam_gun_pos{}; // fix me
 
 		glm::vec3 beam_gun_dims{0.2f, 0.2f, 1.0f};
-		Model beam_gun_model = Model::createHexahedron(
-				beam_gun_dims.x,
-				beam_gun_dims.y,
-				beam_gun_dims.z,
-				glm::vec3(0.0f, 0.0f, 1.0f));
-		ModelID beam_gun_model_id = uploadModel(beam_gun_model);
-		Entity* beam_gun_model_ent = _scene->addStaticEntity(
+		ModelID beam_gun_model_id = uploadModel(Model::createHexahedron(1.0f, 1.0f, 1.0f));
+		player.beam_gun_ent_id = _scene->addStaticEntity(
 				beam_gun_model_id,
 				_default_material_id,
 				beam_gun_pos,
-				AxisAngle{},
+				util::kNoRotation,
 				1.0f); // scale
-	player.beam_gun_ent_id = _scene->static_entities.size() - 1;
+
+		if (player.beam_gun_ent_id.isValid()) {
+			Entity& beam_gun = player.getBeamGunEntity();
+			beam_gun.setScale(beam_gun_dims);
+			beam_gun.color = glm::vec3(0.0f, 0.0f, 1.0f);
+		}
 	}
 }
 
@@ -123,18 +132,27 @@ const bool Engine::loadLevelFile(const std::string& level_filename) const {
 	// **************************************************************************
 	// set up static objects
 	// **************************************************************************
-	for (const auto& platform : level.platforms) {
-		ModelID model_id = uploadModel(platform.model);
+	ModelID cube_model_id = uploadModel(Model::createHexahedron(1.0f, 1.0f, 1.0f));
 
-		Entity* ent = _scene->addStaticEntity(
-				model_id,
+	for (const auto& platform : level.platforms) {
+		StaticEntityID ent_id = _scene->addStaticEntity(
+				cube_model_id,
 				_default_material_id,
 				platform.position,
-				AxisAngle{},
+				util::kNoRotation,
 				1.0f); // scale
-		ent->collision.type = Collision::Type::aabb;
-		ent->collision.shape.box.min_pos = platform.start_pos;
-		ent->collision.shape.box.max_pos = platform.end_pos;
+
+		if (!ent_id.isValid()) {
+			util::logError("level %s has too many platforms", level_filename.c_str());
+			return false;
+		}
+
+		Entity& ent = _scene->getStaticEntity(ent_id);
+		ent.setScale(platform.dimensions);
+		ent.color = platform.color;
+		ent.collision.type = Collision::Type::aabb;
+		ent.collision.shape.box.min_pos = platform.start_pos;
+		ent.collision.shape.box.max_pos = platform.end_pos;
 	}
 
 	// **************************************************************************
@@ -150,8 +168,6 @@ const bool Engine::loadLevelFile(const std::string& level_filename) const {
 	ModelID projectile_model_id = uploadModel(projectile_model);
 
 	for (const auto& fighter : level.fighters) {
-		ModelID model_id = uploadModel(fighter.model);
-
 		glm::vec3 fighter_eye_offset = // temporary
 				glm::vec3(
 						0.0f,
@@ -159,7 +175,7 @@ const bool Engine::loadLevelFile(const std::string& level_filename) const {
 						0.0f);
 
 		PlayableEntity* playable_ent = _scene->addPlayableEntity(
-				model_id,
+				cube_model_id,
 				_default_material_id,
 				fighter.position,
 				fighter.rotation, // rotation_euler (due to view rotation)
@@ -167,10 +183,20 @@ const bool Engine::loadLevelFile(const std::string& level_filename) const {
 				fighter_mass,
 				fighter_eye_offset,
 				projectile_model_id);
+
+		if (!playable_ent) {
+			util::logError("level %s has too many fighters", level_filename.c_str());
+			return false;
+		}
+
+		Entity& render_ent = playable_ent->getRenderEntity();
+		render_ent.setScale(fighter.getScale());
+		render_ent.color = fighter.color;
+
 		float radius = fighter.dimensions.height / 2;
-		DynamicEntity& player_ent = playable_ent->getEntity();
-		player_ent.initCollision(radius);
-		// player_ent.velocity.y = -420.0f;
+		DynamicEntityIndex player_index = _scene->getDynamicEntityIndex(playable_ent->dynamic_ent_id);
+		_scene->dynamic_entities.initCollision(player_index, radius);
+		// _scene->dynamic_entities.bodies[player_index].velocity.y = -420.0f;
 	}
 
 	_scene->player_entity_index = player_fighter_num;
@@ -179,6 +205,13 @@ const bool Engine::loadLevelFile(const std::string& level_filename) const {
 
 	setUpExperimentalGarbage();
 
+	util::log(
+			"uploaded %zu models, reused them %zu times",
+			_geometry_cache.entries.size(),
+			_geometry_cache.hit_count);
+
+	_scene->buildStaticCollision();
+
 	return true;
 }
 
@@ -194,17 +227,23 @@ void Engine::run(const int frames_to_run) {
 	// do a scene step just to get things set up (like the camera)
 	_scene->step(kMinFrameTime, Input::ButtonStates{}, Input::MouseState{});
 
+	_scene->is_checksumming_ticks = _recorder || _replay;
+
 	int frame_count = 0;
 
+	const steady_clock::time_point run_start = frame_start;
+	const uint64_t run_start_tick = _scene->tick_count;
+	uint64_t last_logged_tick = run_start_tick;
+
 	while (isRunning()) {
 		// draw current scene
-		_renderer->draw(_scene);
+		_renderer->draw(_scene, _scene->job_pool);
 		
 		// get frame duration
 		steady_clock::time_point frame_end = steady_clock::now();
 		microseconds frame_duration = duration_cast<microseconds>(frame_end - frame_start);
 
-		if (frame_duration < kMinFrameTime) {
+		if (!_is_headless && frame_duration < kMinFrameTime) {
 			auto sleep_time = kMinFrameTime - frame_duration;
 
 			std::this_thread::sleep_for(sleep_time);
@@ -217,13 +256,39 @@ void Engine::run(const int frames_to_run) {
 
 		util::logFrameStats(frame_duration);
 
+		if (_is_headless && util::shouldLog()) {
+			util::log("ticks per second: %llu", static_cast<unsigned long long>(_scene->tick_count - last_logged_tick));
+			last_logged_tick = _scene->tick_count;
+		}
+
 		// get inputs
 		_window_handler->handleInput();
-		const Input::ButtonStates button_states = _window_handler->getButtonStates();
-		const Input::MouseState mouse_state = _window_handler->getMouseState();
+		Input::ButtonStates button_states = _window_handler->getButtonStates();
+		Input::MouseState mouse_state = _window_handler->getMouseState();
+		microseconds step_duration = _is_headless ? kMinFrameTime : frame_duration;
+		const InputRecording::Frame* replay_frame = nullptr;
+
+		if (_replay) {
+			if (_replay->isDone()) {
+				break;
+			}
+
+			replay_frame = &_replay->nextFrame();
+			button_states = replay_frame->button_states;
+			mouse_state = replay_frame->mouse_state;
+			step_duration = replay_frame->frame_duration;
+		}
 
 		// handle movement and stuff
-		_scene->step(frame_duration, button_states, mouse_state);
+		_scene->step(step_duration, button_states, mouse_state);
+
+		if (_recorder) {
+			_recorder->recordFrame(step_duration, button_states, mouse_state, _scene->tick_checksums);
+		}
+
+		if (replay_frame) {
+			_replay->verifyFrame(*replay_frame, _scene->tick_checksums);
+		}
 		
 		frame_count++;
 		if (frames_to_run > 0 && frame_count > frames_to_run) {
@@ -231,5 +296,25 @@ void Engine::run(const int frames_to_run) {
 		}
 	}
 
+	if (_recorder) {
+		_recorder->close();
+	}
+
+	if (_replay) {
+		_replay->logResult();
+	}
+
+	if (_is_headless) {
+		double seconds = duration_cast<duration<double>>(steady_clock::now() - run_start).count();
+		uint64_t ticks = _scene->tick_count - run_start_tick;
+
+		util::log(
+				"ran %llu ticks in %.3f s: %.0f ticks per second, %.2f us per tick",
+				static_cast<unsigned long long>(ticks),
+				seconds,
+				ticks / seconds,
+				ticks > 0 ? seconds * 1e6 / ticks : 0.0);
+	}
+
 	_renderer->cleanup();
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <geometry_cache.h>
+#include <input_recording.h>
 #include <renderer.h>
 #include <scene.h>
 #include <util.h>
@@ -13,16 +15,40 @@ struct Engine {
 	Scene* _scene;
 	Renderer* _renderer;
 
+	// either can be left as nullptr
+	// while replaying, the recording stands in for both the window's input and
+	// the frame timer
+	InputRecorder* _recorder = nullptr;
+	InputReplay* _replay = nullptr;
+
+	// runs as fast as it can instead of locking the frame rate, stepping the
+	// scene by a fixed amount each frame so runs are comparable, and reports
+	// ticks per second
+	bool _is_headless = false;
+
 	// placeholder
 	uint16_t _default_material_id = 0;
 
+	// so loading doesn't upload the same geometry twice
+	mutable GeometryCache _geometry_cache;
+
 	Engine(WindowHandler* window_handler, Scene* scene, Renderer* renderer) :
 			_window_handler(window_handler),
 			_scene(scene),
 			_renderer(renderer) {};
 
-	const ModelID uploadModel(Model model) const {
-		return _renderer->uploadModel(model);
+	// returns the ModelID of anything already uploaded with the same geometry
+	const ModelID uploadModel(const Model& model) const {
+		ModelID model_id;
+		uint64_t geometry_hash = GeometryCache::hashGeometry(model);
+
+		if (!_geometry_cache.find(geometry_hash, model, model_id)) {
+			model_id = _renderer->uploadModel(model);
+			_geometry_cache.add(geometry_hash, model, model_id);
+			_renderer->_draw_list.setMeshBounds(model_id, model);
+		}
+
+		return model_id;
 	}
 
 	void setUpExperimentalGarbage() const;
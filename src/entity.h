@@ -3,33 +3,49 @@
 #include <collision.h>
 #include <input.h>
 #include <model.h>
+#include <slot_map.h>
 #include <util.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <algorithm>
 
 
-using StaticEntityID = uint16_t;
+struct Entity;
+using StaticEntityID = Handle<Entity>;
+// position in Scene::static_entities, only good until a static entity is removed
+using StaticEntityIndex = uint16_t;
 
 // the in-world representation of any object
-struct Entity { // 64 bytes total
+struct Entity { // 168 bytes total
 	ModelID mesh_id; // identifier for geometry
 	uint16_t material_id; // identifier for shading
+	// the transform should only be changed through the setters below, so the
+	// cached model matrix knows to rebuild
 	// for now, position is basically the circumcenter of the object
 	glm::vec3 position; // 12 bytes
-	// replace (currently Euler angles) rotation with axis-angle
-	// do this because the way I'm currently handling rotations is broken
-	AxisAngle rotation; // 16 bytes
-	float scale = 1.0f; // 4 bytes
+	glm::quat rotation; // 16 bytes
+	// per axis, so shared geometry (e.g. a unit cube) can be stretched into any
+	// box instead of baking the size into its own model
+	glm::vec3 scale{1.0f}; // 12 bytes
+	// multiplies the model's vertex colors, for the same reason
+	glm::vec3 color{1.0f}; // 12 bytes
 	Collision collision; // 28 bytes
+	// where this is drawn relative to position, so things moved by the fixed
+	// rate simulation can be drawn smoothly in between ticks
+	glm::vec3 render_offset{0.0f}; // 12 bytes
+	// only rebuilt when the transform changed since the last getModelMatrix(), so
+	// things that never move (most static entities) cost nothing per frame
+	mutable glm::mat4 model_matrix; // 64 bytes
+	mutable bool is_model_matrix_dirty = true;
 
 	Entity(
 			ModelID mesh_id,
 			uint16_t material_id,
 			glm::vec3 position, // no restriction currently on where an entity's "position" is: for most things, it's the absolute center, but for the player, it's at the bottom
-			AxisAngle rotation,
+			glm::quat rotation,
 			float scale) :
 					mesh_id(mesh_id),
 					material_id(material_id),
@@ -37,61 +53,74 @@ struct Entity { // 64 bytes total
 					rotation(rotation),
 					scale(scale) {}
 
-	const glm::mat4 getModelMatrix() const {
-		glm::mat4 model_matrix = glm::translate(glm::mat4(1.0f), position);
+	// these all skip dirtying the matrix if nothing actually changed
+	void setPosition(const glm::vec3& new_position) {
+		if (new_position != position) {
+			position = new_position;
+			is_model_matrix_dirty = true;
+		}
+	}
+
+	void setRotation(const glm::quat& new_rotation) {
+		if (new_rotation != rotation) {
+			rotation = new_rotation;
+			is_model_matrix_dirty = true;
+		}
+	}
+
+	void setScale(const glm::vec3& new_scale) {
+		if (new_scale != scale) {
+			scale = new_scale;
+			is_model_matrix_dirty = true;
+		}
+	}
+
+	void setScale(const float new_scale) {
+		setScale(glm::vec3(new_scale));
+	}
+
+	void setRenderOffset(const glm::vec3& new_render_offset) {
+		if (new_render_offset != render_offset) {
+			render_offset = new_render_offset;
+			is_model_matrix_dirty = true;
+		}
+	}
 
-		if (rotation.angle != 0.0f) {
-			// special case I guess? not sure why this is necessary
-			model_matrix = glm::rotate(model_matrix, rotation.angle, rotation.axis);
+	// translate * rotate * scale
+	const glm::mat4& getModelMatrix() const {
+		if (is_model_matrix_dirty) {
+			model_matrix = glm::mat4_cast(rotation);
+			model_matrix[0] *= scale.x;
+			model_matrix[1] *= scale.y;
+			model_matrix[2] *= scale.z;
+			model_matrix[3] = glm::vec4(position + render_offset, 1.0f);
+			is_model_matrix_dirty = false;
 		}
 
-		return glm::scale(model_matrix, glm::vec3(scale));
+		return model_matrix;
 	}
 };
 
 
-using DynamicEntityID = uint16_t;
+// dynamic entities don't exist as a single struct, their parts live in
+// separate arrays in an EntityManager (see entity_manager.h)
+// this is only here so their handles have their own type
 struct DynamicEntity;
-using EntityAction = std::function<void(DynamicEntity* self, const float dt_sec)>;
+using DynamicEntityID = Handle<DynamicEntity>;
+// position in Scene::dynamic_entities, only good until a dynamic entity is removed
+using DynamicEntityIndex = uint16_t;
 
-struct DynamicEntity : public Entity {
-	glm::vec3 collisions{0.0f}; // a sum of the direction of collision with each entity
+
+// everything integration needs, and nothing else
+struct RigidBody { // 44 bytes
+	glm::vec3 position;
+	float mass; // 0 means massless: no gravity, and pushed around by everything
 	glm::vec3 velocity{0.0f};
+	float springiness = 0.0f;
 	glm::vec3 force{0.0f};
 	// glm::vec3 angular_velocity{0.0f};
 	// glm::vec3 torque{0.0f};
-	float mass;
-	float springiness = 0.0f;
-
-	// actions
-	bool has_post_action = false;
-	EntityAction post_action;
-
-	// init functions
-	DynamicEntity(
-			ModelID mesh_id,
-			uint16_t material_id,
-			glm::vec3 position,
-			AxisAngle rotation,
-			float scale,
-			float mass) : Entity(mesh_id, material_id, position, rotation, scale), mass(mass) {}
-
-	void initCollision(const float radius) {
-		// always a sphere for now
-		collision.type = Collision::Type::sphere;
-
-		collision.shape.sphere.radius = radius;
-
-		glm::vec3 sphere_pos = position + glm::vec3(0.0f, radius, 0.0f);
-		collision.shape.sphere.center_start = sphere_pos;
-	}
 
-	void setPostAction(EntityAction action) {
-		has_post_action = true;
-		post_action = action;
-	}
-
-	// mid-action functions
 	void applyForce(const glm::vec3 new_force) {
 		force += new_force;
 	}
@@ -109,92 +138,72 @@ struct DynamicEntity : public Entity {
 		force = glm::vec3(0.0f);
 	}
 
-	const glm::vec3 collideWith(const Entity other_entity, glm::vec3& sphere_center_end) {
-		// assume this has sphere and static ent has aabb
-		const Collision::Type other_ent_type = other_entity.collision.type;
-		Sphere& sphere = collision.shape.sphere;
-		glm::vec3 new_position = sphere_center_end;
-
-		if (other_ent_type == Collision::Type::none) {
-			// do nothing
-		} else if (other_ent_type == Collision::Type::aabb) {
-			const AABB& box = other_entity.collision.shape.box;
-
-			glm::vec3 collision_point;
-			bool did_collide = Collision::sphereVsAABB(sphere, sphere_center_end, box, collision_point);
-
-			if (did_collide) {
-				glm::vec3 collision_direction = sphere_center_end - collision_point;
-
-				while (util::isVectorZero(collision_direction)) {
-					// sphere_center_end is now inside the box, so we'll walk the sphere
-					// backwards from the direction it came in, and keep testing it until
-					// it's no longer inside
-					collision_direction = sphere.center_start - sphere_center_end;
-
-					if (util::isVectorZero(collision_direction)) {
-						// just move in a random direction
-						collision_direction = glm::vec3(0.0f, 0.0f, 1.0f);
-					} else {
-						collision_direction = glm::normalize(collision_direction);
-					}
-
-					sphere_center_end = collision_point + (collision_direction * sphere.radius);
-					sphere.center_start = sphere_center_end + (collision_direction * sphere.radius);
-					did_collide = Collision::sphereVsAABB(sphere, sphere_center_end, box, collision_point); // is there any use for did_collide here?
-					collision_direction = sphere_center_end - collision_point;
-				}
-
-				collision_direction = glm::normalize(collision_direction);
-				new_position = collision_point + (collision_direction * sphere.radius);
-
-				// project current velocity along collision direction, and negate the
-				// orthogonal component to provide "bounce back"
-				glm::vec3 parallel = glm::dot(collision_direction, velocity) * collision_direction;
-				glm::vec3 orthogonal = velocity - parallel;
-				velocity = orthogonal - parallel * springiness;
-
-				collisions += collision_direction;
-			}
-		} else if (other_ent_type == Collision::Type::sphere) {
-			const Sphere& other_sphere = other_entity.collision.shape.sphere;
-
-			glm::vec3 separation = sphere_center_end - other_sphere.center_start;
-			glm::vec3 collision_direction;
-			float distance;
-			float final_distance = sphere.radius + other_sphere.radius;
-			
-			if (util::isVectorZero(separation)) {
-				distance = 0.0f;
-
-				if (util::isVectorZero(velocity)) {
-					// arbitrary direction for this edge case
-					collision_direction = glm::vec3(0.0f, 0.0f, 1.0f);
-				} else {
-					// just go backwards
-					collision_direction = glm::normalize(-velocity);
-				}
-			} else {
-				distance = glm::length(separation);
-				collision_direction = glm::normalize(separation);
-			}
-
-			if (distance < final_distance) {
-				// did collide
-				new_position = other_sphere.center_start + final_distance * collision_direction;
-
-				glm::vec3 parallel = glm::dot(collision_direction, velocity) * collision_direction;
-				glm::vec3 orthogonal = velocity - parallel;
-				velocity = orthogonal - parallel * springiness;
-
-				collisions += collision_direction;
-			}
+	// called once we've been moved to the point of contact
+	void bounceOff(const glm::vec3& collision_direction) {
+		float approach_speed = glm::dot(collision_direction, velocity);
+
+		if (approach_speed < 0.0f) {
+			// project current velocity along collision direction, and negate the
+			// parallel component to provide "bounce back"
+			glm::vec3 parallel = approach_speed * collision_direction;
+			glm::vec3 orthogonal = velocity - parallel;
+			velocity = orthogonal - parallel * springiness;
 		}
+	}
+};
+
+
+// dynamic entities always collide as spheres (for now)
+struct SphereCollider { // 32 bytes
+	// collision layers, for deciding which dynamic entities can hit each other
+	static constexpr uint8_t kLayerBody = 1 << 0;
+	static constexpr uint8_t kLayerProjectile = 1 << 1;
+	static constexpr uint8_t kLayerAll = 0xff;
 
-		return new_position;
+	// center_start is where the sphere was at the end of the last sweep, which
+	// is also where the next one starts
+	Sphere sphere{glm::vec3(0.0f), 0.0f};
+	glm::vec3 collisions{0.0f}; // a sum of the direction of collision with each entity
+	uint8_t layer = kLayerBody;
+	uint8_t mask = kLayerAll; // layers this collides with
+
+	const AABB getBounds() const {
+		glm::vec3 radius_extent(sphere.radius);
+		return AABB{sphere.center_start - radius_extent, sphere.center_start + radius_extent};
+	}
+
+	// finds where this sphere first touches other_entity on its way from
+	// sphere.center_start to sphere_center_end
+	const bool collideWith(
+			const Entity& other_entity,
+			const glm::vec3& sphere_center_end,
+			SweepHit& hit) const {
+		switch (other_entity.collision.type) {
+			case Collision::Type::aabb:
+				return Collision::sweptSphereVsAABB(sphere, sphere_center_end, other_entity.collision.shape.box, hit);
+			case Collision::Type::sphere:
+				return Collision::sweptSphereVsSphere(sphere, sphere_center_end, other_entity.collision.shape.sphere, hit);
+			case Collision::Type::mesh:
+				return sweptSphereVsTriangleMesh(sphere, sphere_center_end, *other_entity.collision.shape.mesh, hit);
+			default:
+				return false;
+		}
 	}
 
-	// post-action functions (only call after physics and collisions have taken place)
+	const bool canCollideWith(const SphereCollider& other) const {
+		return (mask & other.layer) && (other.mask & layer);
+	}
+
+	// whether the spheres are within margin of each other, without resolving
+	// anything
+	const bool isTouching(const SphereCollider& other, const float margin) const {
+		float touching_distance = sphere.radius + other.sphere.radius + margin;
+		glm::vec3 separation = sphere.center_start - other.sphere.center_start;
+
+		return glm::dot(separation, separation) <= touching_distance * touching_distance;
+	}
+
+	// only call after physics and collisions have taken place
 	const bool didCollide() const {
 		return !util::isVectorZero(collisions);
 	}
@@ -208,3 +217,25 @@ struct DynamicEntity : public Entity {
 		return collisionDirection().y > 0.5f;
 	}
 };
+
+
+// sleeping entities aren't moved or collided with the world until something
+// wakes them up (see Scene::updateSleep)
+struct SleepState { // 4 bytes
+	// a bit more than gravity adds in one tick, since something resting on the
+	// ground only touches it every other tick (see Scene::kContactSkin)
+	static constexpr float kSleepSpeed = 0.1f; // meters per second
+	static constexpr uint16_t kTicksBeforeSleep = 60;
+
+	uint16_t still_ticks = 0; // how long we've been slower than kSleepSpeed
+	bool is_asleep = false;
+
+	void wake() {
+		is_asleep = false;
+		still_ticks = 0;
+	}
+
+	static const bool isStill(const RigidBody& body) {
+		return glm::dot(body.velocity, body.velocity) < kSleepSpeed * kSleepSpeed;
+	}
+};
@@ -0,0 +1,162 @@
+#include <entity_manager.h>
+
+#include <util.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+void EntityManager::init(const size_t capacity) {
+	allocator.init(capacity);
+
+	bodies.clear();
+	bodies.reserve(allocator.capacity);
+	colliders.clear();
+	colliders.reserve(allocator.capacity);
+	sleep_states.clear();
+	sleep_states.reserve(allocator.capacity);
+	previous_positions.clear();
+	previous_positions.reserve(allocator.capacity);
+	render_entities.clear();
+	render_entities.reserve(allocator.capacity);
+}
+
+
+DynamicEntityID EntityManager::add(
+		const ModelID mesh_id,
+		const uint16_t material_id,
+		const glm::vec3& position,
+		const glm::quat& rotation,
+		const float scale,
+		const float mass) {
+	DynamicEntityID id = allocator.allocate();
+
+	if (!id.isValid()) {
+		return id;
+	}
+
+	RigidBody body;
+	body.position = position;
+	body.mass = mass;
+
+	SphereCollider collider;
+	collider.sphere.center_start = position;
+
+	bodies.push_back(body);
+	colliders.push_back(collider);
+	sleep_states.push_back(SleepState{});
+	previous_positions.push_back(position);
+	render_entities.emplace_back(mesh_id, material_id, position, rotation, scale);
+
+	return id;
+}
+
+
+template <typename T>
+static void swapRemove(std::vector<T>& values, const DynamicEntityIndex index) {
+	if (index != values.size() - 1) {
+		values[index] = std::move(values.back());
+	}
+
+	values.pop_back();
+}
+
+const bool EntityManager::remove(
+		const DynamicEntityID id,
+		DynamicEntityIndex& out_removed_index,
+		DynamicEntityIndex& out_moved_from_index) {
+	if (!allocator.free(id, out_removed_index)) {
+		return false;
+	}
+
+	out_moved_from_index = static_cast<DynamicEntityIndex>(bodies.size() - 1);
+
+	swapRemove(bodies, out_removed_index);
+	swapRemove(colliders, out_removed_index);
+	swapRemove(sleep_states, out_removed_index);
+	swapRemove(previous_positions, out_removed_index);
+	swapRemove(render_entities, out_removed_index);
+
+	return true;
+}
+
+
+void EntityManager::initCollision(const DynamicEntityIndex index, const float radius) {
+	SphereCollider& collider = colliders[index];
+	collider.sphere.radius = radius;
+	collider.sphere.center_start = bodies[index].position + glm::vec3(0.0f, radius, 0.0f);
+}
+
+
+const bool EntityManager::collidePair(const DynamicEntityIndex first, const DynamicEntityIndex second) {
+	RigidBody& body = bodies[first];
+	RigidBody& other_body = bodies[second];
+	SphereCollider& collider = colliders[first];
+	SphereCollider& other_collider = colliders[second];
+
+	glm::vec3 separation = body.position - other_body.position;
+	float final_distance = collider.sphere.radius + other_collider.sphere.radius;
+	float squared_distance = glm::dot(separation, separation);
+
+	if (squared_distance >= final_distance * final_distance) {
+		return false;
+	}
+
+	glm::vec3 relative_velocity = body.velocity - other_body.velocity;
+	glm::vec3 collision_direction; // points from other towards this
+	float distance = std::sqrt(squared_distance);
+
+	if (distance < util::kEpsilon) {
+		if (util::isVectorZero(relative_velocity)) {
+			// arbitrary direction for this edge case
+			collision_direction = glm::vec3(0.0f, 0.0f, 1.0f);
+		} else {
+			// just go backwards
+			collision_direction = glm::normalize(-relative_velocity);
+		}
+	} else {
+		collision_direction = separation / distance;
+	}
+
+	// how much of the correction the first entity takes
+	float share;
+	if (body.mass <= 0.0f && other_body.mass <= 0.0f) {
+		share = 0.5f;
+	} else if (body.mass <= 0.0f) {
+		share = 1.0f;
+	} else if (other_body.mass <= 0.0f) {
+		share = 0.0f;
+	} else {
+		share = other_body.mass / (body.mass + other_body.mass);
+	}
+
+	float penetration = final_distance - distance;
+	body.position += collision_direction * (penetration * share);
+	other_body.position -= collision_direction * (penetration * (1.0f - share));
+
+	// only bounce if they're moving towards each other
+	float approach_speed = glm::dot(relative_velocity, collision_direction);
+
+	if (approach_speed < 0.0f) {
+		float bounce = 1.0f + std::max(body.springiness, other_body.springiness);
+		body.velocity -= collision_direction * (approach_speed * bounce * share);
+		other_body.velocity += collision_direction * (approach_speed * bounce * (1.0f - share));
+	}
+
+	collider.collisions += collision_direction;
+	other_collider.collisions -= collision_direction;
+
+	collider.sphere.center_start = body.position;
+	other_collider.sphere.center_start = other_body.position;
+
+	return true;
+}
+
+
+void EntityManager::syncRenderEntities(const float interpolation_alpha) {
+	for (size_t i = 0; i < size(); i++) {
+		Entity& render_entity = render_entities[i];
+		render_entity.setPosition(bodies[i].position);
+		render_entity.setRenderOffset((previous_positions[i] - bodies[i].position) * (1.0f - interpolation_alpha));
+	}
+}
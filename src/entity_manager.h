@@ -0,0 +1,83 @@
+#pragma once
+
+#include <entity.h>
+#include <slot_map.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// owns every dynamic entity, split up into components that each live in their
+// own dense array, so each system only pulls what it actually uses through
+// the cache (integration only ever touches bodies, for example)
+// all arrays are in the same order and sized up front; removing swaps the last
+// entity into the hole in every one of them
+struct EntityManager {
+	SlotAllocator<DynamicEntity> allocator;
+
+	std::vector<RigidBody> bodies;
+	std::vector<SphereCollider> colliders;
+	std::vector<SleepState> sleep_states;
+	std::vector<glm::vec3> previous_positions; // as of the start of the last tick, for interpolation
+	// what the renderer sees, positions only get copied over once per frame (see
+	// syncRenderEntities)
+	std::vector<Entity> render_entities;
+
+	void init(const size_t capacity);
+
+	// returns an invalid ID if we're full
+	DynamicEntityID add(
+			const ModelID mesh_id,
+			const uint16_t material_id,
+			const glm::vec3& position,
+			const glm::quat& rotation,
+			const float scale,
+			const float mass);
+
+	// returns false if it was already gone
+	// the last entity is moved into its place, out_moved_from_index says where
+	// that was (for anything else that tracks entities by index)
+	const bool remove(const DynamicEntityID id, DynamicEntityIndex& out_removed_index, DynamicEntityIndex& out_moved_from_index);
+
+	const size_t size() const {
+		return bodies.size();
+	}
+
+	const size_t capacity() const {
+		return allocator.capacity;
+	}
+
+	const bool isFull() const {
+		return allocator.isFull();
+	}
+
+	// Handle::kInvalidIndex if the ID is stale
+	const DynamicEntityIndex find(const DynamicEntityID id) const {
+		return allocator.find(id);
+	}
+
+	const bool contains(const DynamicEntityID id) const {
+		return find(id) != DynamicEntityID::kInvalidIndex;
+	}
+
+	const DynamicEntityID handleAt(const DynamicEntityIndex index) const {
+		return allocator.handleAt(index);
+	}
+
+	void initCollision(const DynamicEntityIndex index, const float radius);
+
+	void applyForce(const DynamicEntityIndex index, const glm::vec3& force) {
+		bodies[index].applyForce(force);
+		sleep_states[index].wake();
+	}
+
+	// sphere vs sphere between two entities, pushing both apart and exchanging
+	// velocity along the contact normal
+	// massless entities (mass of 0) get pushed around without pushing back
+	const bool collidePair(const DynamicEntityIndex first, const DynamicEntityIndex second);
+
+	// copies positions over to render_entities, drawn partway between the last
+	// two ticks
+	void syncRenderEntities(const float interpolation_alpha);
+};
@@ -0,0 +1,32 @@
+#include <geometry_cache.h>
+
+#include <util.h>
+
+
+const uint64_t GeometryCache::hashGeometry(const Model& model) {
+	uint64_t hash = util::hashBytes(model.vertices.data(), model.vertices.size() * sizeof(Vertex), util::kHashSeed);
+	hash = util::hashBytes(model.indices.data(), model.indices.size() * sizeof(uint32_t), hash);
+
+	return hash;
+}
+
+const bool GeometryCache::find(const uint64_t hash, const Model& model, ModelID& model_id) {
+	auto range = entries_by_hash.equal_range(hash);
+
+	for (auto it = range.first; it != range.second; it++) {
+		const Entry& entry = entries[it->second];
+
+		if (entry.vertex_count == model.vertices.size() && entry.index_count == model.indices.size()) {
+			model_id = entry.model_id;
+			hit_count++;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void GeometryCache::add(const uint64_t hash, const Model& model, const ModelID model_id) {
+	entries_by_hash.emplace(hash, entries.size());
+	entries.push_back(Entry{hash, model.vertices.size(), model.indices.size(), model_id});
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <model.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+// remembers what's already been uploaded, so identical geometry (every box in
+// a level once they're all unit cubes, the projectile and the pointer balls)
+// shares one ModelID, which the renderer can then draw in a single instanced
+// call (see DrawList)
+// keyed on a 64 bit hash of the vertex and index data itself, so it doesn't
+// matter how a model was built
+// only the hash and counts are kept rather than a copy of the model, so two
+// different meshes would have to collide on all three to get mixed up
+struct GeometryCache {
+	struct Entry {
+		uint64_t hash;
+		size_t vertex_count;
+		size_t index_count;
+		ModelID model_id;
+	};
+
+	std::vector<Entry> entries;
+	std::unordered_multimap<uint64_t, size_t> entries_by_hash; // into entries
+	size_t hit_count = 0;
+
+	// hash is hashGeometry(model), worked out once by the caller for both
+	// returns false if nothing with this geometry has been added
+	const bool find(const uint64_t hash, const Model& model, ModelID& model_id);
+	void add(const uint64_t hash, const Model& model, const ModelID model_id);
+
+	static const uint64_t hashGeometry(const Model& model);
+};
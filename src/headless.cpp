@@ -0,0 +1,14 @@
+#include <headless.h>
+
+
+void ScriptedWindowHandler::handleInput() {
+	frame++;
+
+	_button_states.forward = (frame / 120) % 2 == 0;
+	_button_states.reverse = !_button_states.forward;
+	_button_states.action = true;
+	_button_states.jump = frame % 50 == 0;
+
+	_mouse_state.xOffset = 0.01f;
+	_mouse_state.yOffset = (frame % 200 < 100) ? 0.002f : -0.002f;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <renderer.h>
+#include <window_handler.h>
+
+
+// stand-ins for running the simulation without a window or a GPU, e.g. to
+// profile physics with `severin --headless -f 100000`
+
+
+// hands out model IDs and never draws anything
+struct NullRenderer : Renderer {
+	mutable ModelID next_model_id = 0;
+
+	const bool init() const override {
+		return true;
+	}
+
+	const ModelID uploadModel(const Model model) const override {
+		return next_model_id++;
+	}
+
+	void draw(const Scene* const scene, JobPool& job_pool) const override {}
+
+	void cleanup() const override {}
+};
+
+
+// plays back a fixed pattern of input: walks back and forth, keeps firing,
+// hops every so often, and turns in a slow circle while nodding up and down
+// it never stops on its own, so pair it with -f (or a replay)
+struct ScriptedWindowHandler : WindowHandler {
+	int frame = 0;
+
+	ScriptedWindowHandler() {
+		_is_running = true;
+	}
+
+	void handleInput() override;
+
+	void cleanup() override {}
+};
@@ -0,0 +1,215 @@
+#include <input_recording.h>
+
+#include <util.h>
+
+
+// bit i of a packed button state is kButtons[i], new buttons go on the end
+static constexpr bool Input::ButtonStates::* kButtons[] = {
+	&Input::ButtonStates::forward,
+	&Input::ButtonStates::reverse,
+	&Input::ButtonStates::left,
+	&Input::ButtonStates::right,
+	&Input::ButtonStates::rise,
+	&Input::ButtonStates::fall,
+	&Input::ButtonStates::jump,
+	&Input::ButtonStates::sprint,
+	&Input::ButtonStates::action,
+	&Input::ButtonStates::change_camera,
+};
+
+static_assert(sizeof(kButtons) / sizeof(kButtons[0]) <= 16, "too many buttons to pack");
+
+const uint16_t InputRecording::packButtons(const Input::ButtonStates& button_states) {
+	uint16_t bits = 0;
+
+	for (size_t i = 0; i < sizeof(kButtons) / sizeof(kButtons[0]); i++) {
+		if (button_states.*kButtons[i]) {
+			bits |= 1 << i;
+		}
+	}
+
+	return bits;
+}
+
+const Input::ButtonStates InputRecording::unpackButtons(const uint16_t bits) {
+	Input::ButtonStates button_states;
+
+	for (size_t i = 0; i < sizeof(kButtons) / sizeof(kButtons[0]); i++) {
+		button_states.*kButtons[i] = (bits >> i) & 1;
+	}
+
+	return button_states;
+}
+
+
+template <typename T>
+static void writeValue(std::ofstream& file, const T& value) {
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static const bool readValue(std::ifstream& file, T& value) {
+	file.read(reinterpret_cast<char*>(&value), sizeof(T));
+	return static_cast<bool>(file);
+}
+
+
+const bool InputRecorder::open(const std::string& path, const uint32_t ticks_per_second) {
+	file.open(path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open()) {
+		util::logError("couldn't open %s for recording", path.c_str());
+		return false;
+	}
+
+	InputRecording::Header header;
+	header.ticks_per_second = ticks_per_second;
+	writeValue(file, header);
+	frame_count = 0;
+
+	util::log("recording input to %s", path.c_str());
+
+	return true;
+}
+
+void InputRecorder::close() {
+	if (file.is_open()) {
+		file.close();
+		util::log("recorded %zu frames", frame_count);
+	}
+}
+
+void InputRecorder::recordFrame(
+		const std::chrono::microseconds frame_duration,
+		const Input::ButtonStates& button_states,
+		const Input::MouseState& mouse_state,
+		const std::vector<uint64_t>& tick_checksums) {
+	writeValue(file, static_cast<int64_t>(frame_duration.count()));
+	writeValue(file, InputRecording::packButtons(button_states));
+	writeValue(file, mouse_state.xOffset);
+	writeValue(file, mouse_state.yOffset);
+	writeValue(file, static_cast<uint16_t>(tick_checksums.size()));
+
+	for (uint64_t checksum : tick_checksums) {
+		writeValue(file, checksum);
+	}
+
+	frame_count++;
+}
+
+
+const bool InputReplay::load(const std::string& path, const uint32_t ticks_per_second) {
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file.is_open()) {
+		util::logError("couldn't open replay %s", path.c_str());
+		return false;
+	}
+
+	InputRecording::Header header;
+
+	if (!readValue(file, header) || header.magic != InputRecording::kMagic) {
+		util::logError("%s isn't a recording", path.c_str());
+		return false;
+	}
+
+	if (header.version != InputRecording::kVersion || header.ticks_per_second != ticks_per_second) {
+		util::logError(
+				"%s is version %u at %u ticks per second, expected version %u at %u",
+				path.c_str(),
+				header.version,
+				header.ticks_per_second,
+				InputRecording::kVersion,
+				ticks_per_second);
+		return false;
+	}
+
+	frames.clear();
+	checksums.clear();
+	next_frame = 0;
+	ticks_checked = 0;
+	has_diverged = false;
+
+	while (file.peek() != std::ifstream::traits_type::eof()) {
+		int64_t frame_duration_us;
+		uint16_t button_bits;
+		InputRecording::Frame frame;
+
+		if (!readValue(file, frame_duration_us)
+				|| !readValue(file, button_bits)
+				|| !readValue(file, frame.mouse_state.xOffset)
+				|| !readValue(file, frame.mouse_state.yOffset)
+				|| !readValue(file, frame.tick_count)) {
+			util::logError("replay %s is cut off after %zu frames", path.c_str(), frames.size());
+			break;
+		}
+
+		frame.frame_duration = std::chrono::microseconds(frame_duration_us);
+		frame.button_states = InputRecording::unpackButtons(button_bits);
+		frame.first_checksum = static_cast<uint32_t>(checksums.size());
+
+		bool is_complete = true;
+
+		for (uint16_t i = 0; i < frame.tick_count && is_complete; i++) {
+			uint64_t checksum;
+			is_complete = readValue(file, checksum);
+			checksums.push_back(checksum);
+		}
+
+		if (!is_complete) {
+			util::logError("replay %s is cut off after %zu frames", path.c_str(), frames.size());
+			checksums.resize(frame.first_checksum);
+			break;
+		}
+
+		frames.push_back(frame);
+	}
+
+	util::log("loaded replay %s: %zu frames, %zu ticks", path.c_str(), frames.size(), checksums.size());
+
+	return true;
+}
+
+const bool InputReplay::verifyFrame(const InputRecording::Frame& frame, const std::vector<uint64_t>& tick_checksums) {
+	if (has_diverged) {
+		return false;
+	}
+
+	if (tick_checksums.size() != frame.tick_count) {
+		util::logError(
+				"replay diverged after %zu ticks: ran %zu ticks in frame %zu, recording has %u",
+				ticks_checked,
+				tick_checksums.size(),
+				next_frame - 1,
+				frame.tick_count);
+		has_diverged = true;
+		return false;
+	}
+
+	for (size_t i = 0; i < tick_checksums.size(); i++) {
+		uint64_t expected = checksums[frame.first_checksum + i];
+
+		if (tick_checksums[i] != expected) {
+			util::logError(
+					"replay diverged at tick %zu (frame %zu): checksum %016llx, recording has %016llx",
+					ticks_checked,
+					next_frame - 1,
+					static_cast<unsigned long long>(tick_checksums[i]),
+					static_cast<unsigned long long>(expected));
+			has_diverged = true;
+			return false;
+		}
+
+		ticks_checked++;
+	}
+
+	return true;
+}
+
+void InputReplay::logResult() const {
+	if (has_diverged) {
+		util::logError("replay did not match the recording (%zu ticks matched)", ticks_checked);
+	} else {
+		util::log("replay matched the recording for all %zu ticks checked", ticks_checked);
+	}
+}
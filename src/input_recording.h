@@ -0,0 +1,85 @@
+#pragma once
+
+#include <input.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// a run of the engine boiled down to what Scene::step was given each frame,
+// plus a checksum of the scene after every tick, so a replay can be driven
+// exactly the same way and can tell the moment it stops matching
+//
+// file layout (little endian), after the header:
+//   int64 frame duration (us), uint16 buttons, float mouse x, float mouse y,
+//   uint16 tick count, then a uint64 checksum per tick
+namespace InputRecording {
+	constexpr uint32_t kMagic = 0x4e525653; // "SVRN"
+	constexpr uint32_t kVersion = 1;
+
+	struct Header {
+		uint32_t magic = kMagic;
+		uint32_t version = kVersion;
+		uint32_t ticks_per_second = 0; // has to match Scene::kTicksPerSecond to replay
+	};
+
+	struct Frame {
+		std::chrono::microseconds frame_duration{0};
+		Input::ButtonStates button_states;
+		Input::MouseState mouse_state;
+		uint32_t first_checksum = 0; // into InputReplay::checksums
+		uint16_t tick_count = 0;
+	};
+
+	const uint16_t packButtons(const Input::ButtonStates& button_states);
+	const Input::ButtonStates unpackButtons(const uint16_t bits);
+}
+
+
+struct InputRecorder {
+	std::ofstream file;
+	size_t frame_count = 0;
+
+	const bool open(const std::string& path, const uint32_t ticks_per_second);
+	void close();
+
+	const bool isOpen() const {
+		return file.is_open();
+	}
+
+	void recordFrame(
+			const std::chrono::microseconds frame_duration,
+			const Input::ButtonStates& button_states,
+			const Input::MouseState& mouse_state,
+			const std::vector<uint64_t>& tick_checksums);
+};
+
+
+// the whole file is read up front, so replaying doesn't touch the disk
+struct InputReplay {
+	std::vector<InputRecording::Frame> frames;
+	std::vector<uint64_t> checksums;
+	size_t next_frame = 0;
+	size_t ticks_checked = 0;
+	bool has_diverged = false;
+
+	const bool load(const std::string& path, const uint32_t ticks_per_second);
+
+	const bool isDone() const {
+		return next_frame >= frames.size();
+	}
+
+	const InputRecording::Frame& nextFrame() {
+		return frames[next_frame++];
+	}
+
+	// compares the ticks we just ran for frame against the recording, logging
+	// the first tick that doesn't match
+	// returns false once anything has diverged
+	const bool verifyFrame(const InputRecording::Frame& frame, const std::vector<uint64_t>& tick_checksums);
+
+	void logResult() const;
+};
@@ -0,0 +1,122 @@
+#include <job_pool.h>
+
+#include <util.h>
+
+#include <algorithm>
+
+
+void JobPool::start(int thread_count) {
+	stop();
+
+	if (thread_count <= 0) {
+		thread_count = static_cast<int>(std::thread::hardware_concurrency());
+	}
+
+	thread_count = std::clamp(thread_count, 1, kMaxThreads);
+
+	stopping = false;
+
+	// workers are handed the current generation rather than reading it
+	// themselves, otherwise a worker that's slow to start could miss the first job
+	for (int i = 1; i < thread_count; i++) {
+		workers.emplace_back(&JobPool::workerLoop, this, i, generation);
+	}
+
+	util::log("job pool running on %d threads", threadCount());
+}
+
+void JobPool::stop() {
+	if (workers.empty()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	work_ready.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	workers.clear();
+}
+
+
+void JobPool::parallelFor(const size_t count, const size_t min_batch_size, const RangeJob& range_job) {
+	if (count == 0) {
+		return;
+	}
+
+	size_t thread_count = threadCount();
+	size_t new_batch_size = (count + thread_count * kBatchesPerThread - 1) / (thread_count * kBatchesPerThread);
+	new_batch_size = std::max(new_batch_size, std::max(min_batch_size, size_t(1)));
+
+	if (workers.empty() || new_batch_size >= count) {
+		range_job(0, count, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &range_job;
+		job_count = count;
+		batch_size = new_batch_size;
+		batch_count = (count + batch_size - 1) / batch_size;
+		next_batch = 0;
+		busy_workers = static_cast<int>(workers.size());
+		generation++;
+	}
+
+	work_ready.notify_all();
+
+	runBatches(0);
+
+	// the job lives on our stack, so every worker has to be done with it
+	std::unique_lock<std::mutex> lock(mutex);
+	work_done.wait(lock, [&] { return busy_workers == 0; });
+	job = nullptr;
+}
+
+
+void JobPool::workerLoop(const int worker_index, uint64_t seen_generation) {
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			work_ready.wait(lock, [&] { return stopping || generation != seen_generation; });
+
+			if (stopping) {
+				return;
+			}
+
+			seen_generation = generation;
+		}
+
+		runBatches(worker_index);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy_workers--;
+
+			if (busy_workers == 0) {
+				work_done.notify_one();
+			}
+		}
+	}
+}
+
+void JobPool::runBatches(const int worker_index) {
+	while (true) {
+		size_t batch = next_batch.fetch_add(1);
+
+		if (batch >= batch_count) {
+			return;
+		}
+
+		size_t begin = batch * batch_size;
+		size_t end = std::min(begin + batch_size, job_count);
+		(*job)(begin, end, worker_index);
+	}
+}
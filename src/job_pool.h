@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// a fixed set of worker threads that split up a range of work between them
+// the calling thread always helps out, and is worker 0
+// work is handed out in batches, so which worker gets which batch changes from
+// run to run: jobs must only write to the items in their own range (plus
+// per-worker scratch) if the results need to be deterministic
+struct JobPool {
+	using RangeJob = std::function<void(const size_t begin, const size_t end, const int worker_index)>;
+
+	// no point going wider than this for what we do
+	static constexpr int kMaxThreads = 32;
+	// batches per thread, so a thread that gets slow batches doesn't hold
+	// everyone else up
+	static constexpr size_t kBatchesPerThread = 4;
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+	uint64_t generation = 0; // bumped every time there's new work
+	int busy_workers = 0;
+	bool stopping = false;
+
+	// the current job, only valid while parallelFor is running
+	const RangeJob* job = nullptr;
+	size_t job_count = 0;
+	size_t batch_size = 0;
+	size_t batch_count = 0;
+	std::atomic<size_t> next_batch{0};
+
+	JobPool() = default;
+	JobPool(const JobPool&) = delete;
+	JobPool& operator=(const JobPool&) = delete;
+
+	~JobPool() {
+		stop();
+	}
+
+	// thread_count includes the calling thread, 0 means one per core
+	void start(int thread_count = 0);
+	void stop();
+
+	const int threadCount() const {
+		return static_cast<int>(workers.size()) + 1;
+	}
+
+	// calls job on batches of [0, count), blocking until all of them are done
+	// batches are never smaller than min_batch_size (except for the last one), so
+	// small jobs just run on the calling thread
+	void parallelFor(const size_t count, const size_t min_batch_size, const RangeJob& range_job);
+
+	void workerLoop(const int worker_index, uint64_t seen_generation);
+	void runBatches(const int worker_index);
+};
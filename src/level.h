@@ -14,18 +14,19 @@ void logLevelLoadError(const char* message, std::string line) {
 
 
 struct Level {
+  // platforms and fighters are all drawn as a unit cube, scaled to their
+  // dimensions and tinted their color
   struct Platform {
     glm::vec3 position;
 		glm::vec3 start_pos;
 		glm::vec3 end_pos;
-    Model model;
+		glm::vec3 dimensions;
+		glm::vec3 color;
 
 		Platform(glm::vec3 start_pos, glm::vec3 end_pos, glm::vec3 color) :
-				start_pos(start_pos), end_pos(end_pos) {
+				start_pos(start_pos), end_pos(end_pos), color(color) {
 			position = (start_pos + end_pos) * 0.5f;
-
-			glm::vec3 dimensions = end_pos - start_pos;
-			model = Model::createHexahedron(dimensions.x, dimensions.y, dimensions.z, color);
+			dimensions = end_pos - start_pos;
 		}
   };
 
@@ -39,16 +40,16 @@ struct Level {
     glm::vec3 position;
     glm::vec3 rotation;
 		Dimensions dimensions;
-		Model model;
+		glm::vec3 color{0.0f, 0.0f, 1.0f};
 
 		Fighter(Dimensions dims, glm::vec3 pos, glm::vec3 rot) {
 			position = pos;
 			rotation = rot;
 			dimensions = dims;
+		}
 
-			glm::vec3 color(0.0f, 0.0f, 1.0f);
-
-			model = Model::createHexahedron(dims.width, dims.height, dims.width, color);
+		const glm::vec3 getScale() const {
+			return glm::vec3(dimensions.width, dimensions.height, dimensions.width);
 		}
   };
 
@@ -1,4 +1,6 @@
 #include <engine.h>
+#include <headless.h>
+#include <input_recording.h>
 #include <renderer.h>
 #include <scene.h>
 #include <util.h>
@@ -7,10 +9,11 @@
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
 
 
 void printUsage() {
-	printf("usage: severin [-w window_width] [-h window_height] [-f frames_to_run]\n");
+	printf("usage: severin [-w window_width] [-h window_height] [-f frames_to_run] [-t thread_count] [-r record_file | -p replay_file] [--headless] [--full-vertices]\n");
 	exit(0);
 }
 
@@ -18,6 +21,11 @@ struct ArgumentOptions {
 	int window_width = kDefaultWindowWidth;
 	int window_height = kDefaultWindowHeight;
 	int frames_to_run = 0; // set to non-zero to debug
+	int thread_count = 0; // for physics and the object buffer, 0 means one per core
+	std::string record_file; // empty if not recording
+	std::string replay_file; // empty if not replaying
+	bool is_headless = false; // no window or rendering, scripted input, no frame limit
+	bool use_full_vertices = false; // upload full precision vertices instead of packed ones
 };
 
 ArgumentOptions parseArguments(int argc, char* argv[]) {
@@ -48,11 +56,40 @@ ArgumentOptions parseArguments(int argc, char* argv[]) {
 			} else {
 				printUsage();
 			}
+		} else if (arg == "-t") {
+			i += 1;
+			if (i < argc) {
+				options.thread_count = atoi(argv[i]);
+			} else {
+				printUsage();
+			}
+		} else if (arg == "-r") {
+			i += 1;
+			if (i < argc) {
+				options.record_file = argv[i];
+			} else {
+				printUsage();
+			}
+		} else if (arg == "-p") {
+			i += 1;
+			if (i < argc) {
+				options.replay_file = argv[i];
+			} else {
+				printUsage();
+			}
+		} else if (arg == "--headless") {
+			options.is_headless = true;
+		} else if (arg == "--full-vertices") {
+			options.use_full_vertices = true;
 		} else {
 			printUsage();
 		}
 	}
 
+	if (!options.record_file.empty() && !options.replay_file.empty()) {
+		printUsage();
+	}
+
 	return options;
 }
 
@@ -63,10 +100,20 @@ int main(int argc, char* argv[]) {
 	ArgumentOptions options = parseArguments(argc, argv);
 
 	// setup
-	WindowHandler window_handler(options.window_width, options.window_height);
-	Renderer renderer(&window_handler);
+	std::unique_ptr<WindowHandler> window_handler;
+	std::unique_ptr<Renderer> renderer;
+
+	if (options.is_headless) {
+		window_handler = std::make_unique<ScriptedWindowHandler>();
+		renderer = std::make_unique<NullRenderer>();
+	} else {
+		window_handler = std::make_unique<WindowHandler>(options.window_width, options.window_height);
+		renderer = std::make_unique<Renderer>(window_handler.get());
+	}
 
-	if (!renderer.init()) {
+	renderer->_use_packed_vertices = !options.use_full_vertices;
+
+	if (!renderer->init()) {
 		util::logError("renderer failed to init");
 		return EXIT_FAILURE;
 	}
@@ -75,7 +122,9 @@ int main(int argc, char* argv[]) {
 			static_cast<float>(options.window_width) / options.window_height;
 	Camera camera(aspect_ratio);
 	Scene scene(camera);
-	Engine engine(&window_handler, &scene, &renderer);
+	scene.startWorkers(options.thread_count);
+	Engine engine(window_handler.get(), &scene, renderer.get());
+	engine._is_headless = options.is_headless;
 
 	// load level
 #ifdef _MSC_VER
@@ -92,6 +141,26 @@ int main(int argc, char* argv[]) {
 		return EXIT_FAILURE;
 	}
 
+	// recording and replaying need to start from the freshly loaded level
+	InputRecorder recorder;
+	InputReplay replay;
+
+	if (!options.record_file.empty()) {
+		if (!recorder.open(options.record_file, Scene::kTicksPerSecond)) {
+			return EXIT_FAILURE;
+		}
+
+		engine._recorder = &recorder;
+	}
+
+	if (!options.replay_file.empty()) {
+		if (!replay.load(options.replay_file, Scene::kTicksPerSecond)) {
+			return EXIT_FAILURE;
+		}
+
+		engine._replay = &replay;
+	}
+
 	// let's go!
 	engine.run(options.frames_to_run);
 
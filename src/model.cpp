@@ -1,9 +1,15 @@
 #include <model.h>
 #include <util.h>
 
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <tiny_obj_loader.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <unordered_map>
 
 
 
@@ -43,10 +49,18 @@ Model Model::createTriangle() {
 	model.vertices[1].color = { 0.0f, 1.0f, 0.0f};
 	model.vertices[2].color = { 0.0f, 0.0f, 1.0f};
 
+	model.indices = {0, 1, 2};
+
 	return model;
 }
 
+// appends the triangle as three new vertices, optimize() welds them later
 void insertTriangle(Model& model, Triangle triangle) {
+	uint32_t first_index = static_cast<uint32_t>(model.vertices.size());
+	model.indices.push_back(first_index);
+	model.indices.push_back(first_index + 1);
+	model.indices.push_back(first_index + 2);
+
 	model.vertices.push_back(triangle.v0);
 	model.vertices.push_back(triangle.v1);
 	model.vertices.push_back(triangle.v2);
@@ -98,6 +112,8 @@ Model Model::createHexahedron(float width, float height, float depth, glm::vec3
 	insertTriangle(model, Triangle(rtf, rbf, rbr, color));
 	insertTriangle(model, Triangle(rbr, rtr, rtf, color));
 
+	model.optimize();
+
 	return model;
 }
 
@@ -144,6 +160,8 @@ Model Model::createIcosahedron(glm::vec3 color) {
 	insertTriangle(model, Triangle(z3, z4, x4, color));
 	insertTriangle(model, Triangle(z3, x4, y2, color));
 
+	model.optimize();
+
 	return model;
 }
 
@@ -159,10 +177,10 @@ Model subdivide(Model original, glm::vec3 color) {
 
 	float length = glm::length(original.vertices[0].position);
 
-	for (int i = 0; i < original.vertices.size(); i += 3) {
-		glm::vec3 v0 = original.vertices[i].position;
-		glm::vec3 v1 = original.vertices[i + 1].position;
-		glm::vec3 v2 = original.vertices[i + 2].position;
+	for (size_t i = 0; i < original.indices.size(); i += 3) {
+		glm::vec3 v0 = original.vertices[original.indices[i]].position;
+		glm::vec3 v1 = original.vertices[original.indices[i + 1]].position;
+		glm::vec3 v2 = original.vertices[original.indices[i + 2]].position;
 
 		glm::vec3 v01 = midpoint(v0, v1) * length;
 		glm::vec3 v12 = midpoint(v1, v2) * length;
@@ -176,11 +194,13 @@ Model subdivide(Model original, glm::vec3 color) {
 
 	// make the vertex normals point away from the center of the ball, rather
 	// than aligned to the triangle
-	for (int i = 0; i < original.vertices.size(); i++) {
-		Vertex& vert = original.vertices[i];
+	// this also makes the copies of a corner identical, so they weld into one
+	for (Vertex& vert : new_model.vertices) {
 		vert.normal = util::safeNormalize(vert.position);
 	}
 
+	new_model.optimize();
+
 	return new_model;
 }
 
@@ -252,6 +272,7 @@ Model Model::createFromOBJ(
 				// new_vertex.color = new_vertex.normal;
 				new_vertex.color = glm::vec3(material.diffuse[0], material.diffuse[1], material.diffuse[2]);
 
+				model.indices.push_back(static_cast<uint32_t>(model.vertices.size()));
 				model.vertices.push_back(new_vertex);
 			}
 
@@ -263,9 +284,405 @@ Model Model::createFromOBJ(
 	constexpr float size = 0.02f;
 	Model hex = Model::createHexahedron(size, size, size);
 
+	uint32_t hex_offset = static_cast<uint32_t>(model.vertices.size());
+
 	for (const auto& vertex : hex.vertices) {
 		model.vertices.push_back(vertex);
 	}
 
+	for (uint32_t index : hex.indices) {
+		model.indices.push_back(hex_offset + index);
+	}
+
+	size_t unwelded_vertex_count = model.vertices.size();
+	model.optimize();
+
+	util::log(
+			"loaded %s: %zu triangles, %zu vertices (%zu before welding), %.2f vertex shader runs per triangle",
+			file_path.c_str(),
+			model.getTriangleCount(),
+			model.vertices.size(),
+			unwelded_vertex_count,
+			model.getCacheMissRatio());
+
 	return model;
 }
+
+
+void Model::optimize() {
+	weldVertices();
+	optimizeVertexCache();
+	optimizeVertexFetch();
+}
+
+static_assert(sizeof(Vertex) == 11 * sizeof(float), "welding compares vertices byte for byte, so Vertex can't have padding");
+
+struct VertexBytesHash {
+	size_t operator()(const Vertex& vertex) const {
+		return static_cast<size_t>(util::hashBytes(&vertex, sizeof(Vertex)));
+	}
+};
+
+struct VertexBytesEqual {
+	bool operator()(const Vertex& a, const Vertex& b) const {
+		return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+	}
+};
+
+void Model::weldVertices() {
+	std::unordered_map<Vertex, uint32_t, VertexBytesHash, VertexBytesEqual> unique_indices;
+	unique_indices.reserve(vertices.size());
+
+	std::vector<Vertex> welded_vertices;
+	std::vector<uint32_t> remap(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		// -0 and 0 are the same value with different bits (a cross product
+		// happily gives either), so flush them all to 0 first
+		Vertex vertex = vertices[i];
+		float* components = reinterpret_cast<float*>(&vertex);
+
+		for (size_t j = 0; j < sizeof(Vertex) / sizeof(float); j++) {
+			components[j] += 0.0f;
+		}
+
+		auto inserted = unique_indices.emplace(vertex, static_cast<uint32_t>(welded_vertices.size()));
+
+		if (inserted.second) {
+			welded_vertices.push_back(vertex);
+		}
+
+		remap[i] = inserted.first->second;
+	}
+
+	for (uint32_t& index : indices) {
+		index = remap[index];
+	}
+
+	vertices = std::move(welded_vertices);
+}
+
+
+// Forsyth's scoring: the last triangle's vertices get a flat score so the
+// next triangle doesn't just reuse the same edge, the rest of the cache
+// scores less the older it is, and vertices with few triangles left get a
+// boost so they're finished off instead of being left stranded
+static constexpr float kCacheDecayPower = 1.5f;
+static constexpr float kLastTriangleScore = 0.75f;
+static constexpr float kValenceBoostScale = 2.0f;
+static constexpr float kValenceBoostPower = 0.5f;
+
+static const float vertexCacheScore(const int cache_position, const uint32_t remaining_triangles) {
+	if (remaining_triangles == 0) {
+		return -1.0f; // nothing left to draw with it
+	}
+
+	float score = 0.0f;
+
+	if (cache_position < 0) {
+		// not in the cache
+	} else if (cache_position < 3) {
+		score = kLastTriangleScore;
+	} else {
+		float scale = 1.0f / (Model::kVertexCacheSize - 3);
+		score = std::pow(1.0f - (cache_position - 3) * scale, kCacheDecayPower);
+	}
+
+	return score + kValenceBoostScale * std::pow(static_cast<float>(remaining_triangles), -kValenceBoostPower);
+}
+
+void Model::optimizeVertexCache() {
+	constexpr uint32_t kNoTriangle = UINT32_MAX;
+	// a triangle's worth of vertices gets pushed in before the oldest ones fall
+	// out the back
+	constexpr size_t kSimulatedCacheSize = kVertexCacheSize + 3;
+
+	size_t triangle_count = getTriangleCount();
+
+	if (triangle_count == 0) {
+		return;
+	}
+
+	// the triangles using each vertex, packed into one array, the not yet
+	// emitted ones come first in each vertex's range
+	std::vector<uint32_t> remaining_triangles(vertices.size(), 0);
+	std::vector<uint32_t> first_triangle(vertices.size() + 1, 0);
+
+	for (uint32_t index : indices) {
+		remaining_triangles[index]++;
+	}
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		first_triangle[i + 1] = first_triangle[i] + remaining_triangles[i];
+	}
+
+	std::vector<uint32_t> vertex_triangles(indices.size());
+	std::vector<uint32_t> fill_count(vertices.size(), 0);
+
+	for (size_t i = 0; i < indices.size(); i++) {
+		uint32_t vertex = indices[i];
+		vertex_triangles[first_triangle[vertex] + fill_count[vertex]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<int> cache_positions(vertices.size(), -1);
+	std::vector<float> vertex_scores(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		vertex_scores[i] = vertexCacheScore(-1, remaining_triangles[i]);
+	}
+
+	std::vector<float> triangle_scores(triangle_count);
+	std::vector<bool> is_emitted(triangle_count, false);
+	uint32_t best_triangle = 0;
+
+	for (size_t i = 0; i < triangle_count; i++) {
+		triangle_scores[i] = vertex_scores[indices[3 * i]] + vertex_scores[indices[3 * i + 1]] + vertex_scores[indices[3 * i + 2]];
+
+		if (triangle_scores[i] > triangle_scores[best_triangle]) {
+			best_triangle = static_cast<uint32_t>(i);
+		}
+	}
+
+	std::vector<uint32_t> sorted_indices;
+	sorted_indices.reserve(indices.size());
+
+	uint32_t cache[kSimulatedCacheSize + 3];
+	size_t cache_count = 0;
+
+	// for when nothing in the cache has triangles left: carry on from the most
+	// recently used vertex that still has some, so we keep growing the patch
+	// we've drawn instead of starting a new one somewhere else
+	std::vector<uint32_t> dead_end_stack;
+	dead_end_stack.reserve(indices.size());
+	size_t next_unemitted = 0; // and if there isn't one, the first triangle left
+
+	for (size_t emitted = 0; emitted < triangle_count; emitted++) {
+		while (best_triangle == kNoTriangle && !dead_end_stack.empty()) {
+			uint32_t vertex = dead_end_stack.back();
+			dead_end_stack.pop_back();
+
+			if (remaining_triangles[vertex] > 0) {
+				best_triangle = vertex_triangles[first_triangle[vertex]];
+			}
+		}
+
+		if (best_triangle == kNoTriangle) {
+			while (is_emitted[next_unemitted]) {
+				next_unemitted++;
+			}
+
+			best_triangle = static_cast<uint32_t>(next_unemitted);
+		}
+
+		const uint32_t* triangle = &indices[3 * best_triangle];
+		is_emitted[best_triangle] = true;
+
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t vertex = triangle[corner];
+			sorted_indices.push_back(vertex);
+			dead_end_stack.push_back(vertex);
+
+			// swap it out of the vertex's remaining triangles
+			uint32_t* vertex_begin = &vertex_triangles[first_triangle[vertex]];
+			uint32_t* vertex_end = vertex_begin + remaining_triangles[vertex];
+			std::iter_swap(std::find(vertex_begin, vertex_end, best_triangle), vertex_end - 1);
+			remaining_triangles[vertex]--;
+		}
+
+		// the triangle's vertices go to the front, everything else shuffles back
+		uint32_t new_cache[kSimulatedCacheSize + 3];
+		size_t new_cache_count = 0;
+
+		for (int corner = 0; corner < 3; corner++) {
+			new_cache[new_cache_count++] = triangle[corner];
+		}
+
+		for (size_t i = 0; i < cache_count; i++) {
+			uint32_t vertex = cache[i];
+
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+				new_cache[new_cache_count++] = vertex;
+			}
+		}
+
+		// rescore everything that was or is in the cache, and the triangles
+		// they're still part of
+		best_triangle = kNoTriangle;
+		float best_score = -1.0f;
+
+		for (size_t i = 0; i < new_cache_count; i++) {
+			uint32_t vertex = new_cache[i];
+			cache_positions[vertex] = i < kSimulatedCacheSize ? static_cast<int>(i) : -1;
+
+			float score = vertexCacheScore(cache_positions[vertex], remaining_triangles[vertex]);
+			float score_change = score - vertex_scores[vertex];
+			vertex_scores[vertex] = score;
+
+			const uint32_t* vertex_begin = &vertex_triangles[first_triangle[vertex]];
+
+			for (uint32_t j = 0; j < remaining_triangles[vertex]; j++) {
+				uint32_t other = vertex_begin[j];
+				triangle_scores[other] += score_change;
+
+				if (triangle_scores[other] > best_score) {
+					best_score = triangle_scores[other];
+					best_triangle = other;
+				}
+			}
+		}
+
+		cache_count = std::min(new_cache_count, kSimulatedCacheSize);
+		std::copy(new_cache, new_cache + cache_count, cache);
+	}
+
+	indices = std::move(sorted_indices);
+}
+
+void Model::optimizeVertexFetch() {
+	constexpr uint32_t kUnused = UINT32_MAX;
+
+	std::vector<uint32_t> remap(vertices.size(), kUnused);
+	std::vector<Vertex> sorted_vertices;
+	sorted_vertices.reserve(vertices.size());
+
+	for (uint32_t& index : indices) {
+		if (remap[index] == kUnused) {
+			remap[index] = static_cast<uint32_t>(sorted_vertices.size());
+			sorted_vertices.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	// anything no triangle uses gets dropped
+	vertices = std::move(sorted_vertices);
+}
+
+const float Model::getCacheMissRatio(const size_t cache_size) const {
+	if (indices.empty() || cache_size == 0) {
+		return 0.0f;
+	}
+
+	std::vector<size_t> cached_at(vertices.size(), 0); // when each vertex went in
+	size_t misses = 0;
+
+	for (uint32_t index : indices) {
+		// misses so far is the FIFO's clock, anything that went in more than
+		// cache_size misses ago has been pushed out
+		if (cached_at[index] == 0 || misses - cached_at[index] + 1 > cache_size) {
+			misses++;
+			cached_at[index] = misses;
+		}
+	}
+
+	return static_cast<float>(misses) / getTriangleCount();
+}
+
+
+// octahedral normals: fold the unit sphere onto the octahedron |x|+|y|+|z| = 1,
+// then unfold its bottom half over the corners of the top half's square
+static const glm::vec2 encodeOctahedral(const glm::vec3& normal) {
+	float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+	if (length < util::kEpsilon) {
+		return glm::vec2(0.0f); // no normal, it comes back pointing up z
+	}
+
+	glm::vec3 n = normal / length;
+	glm::vec2 encoded(n.x, n.y);
+
+	if (n.z < 0.0f) {
+		encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return encoded;
+}
+
+// has to match octahedralDecode in mesh_packed.vert
+static const glm::vec3 decodeOctahedral(const glm::vec2& encoded) {
+	glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	float fold = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -fold : fold;
+	n.y += n.y >= 0.0f ? -fold : fold;
+
+	return glm::normalize(n);
+}
+
+const PackedModel Model::pack() const {
+	PackedModel packed;
+	packed.indices = indices;
+
+	if (vertices.empty()) {
+		return packed;
+	}
+
+	glm::vec3 bounds_min = vertices[0].position;
+	glm::vec3 bounds_max = vertices[0].position;
+
+	for (const Vertex& vertex : vertices) {
+		bounds_min = glm::min(bounds_min, vertex.position);
+		bounds_max = glm::max(bounds_max, vertex.position);
+	}
+
+	glm::vec3 bounds_size = bounds_max - bounds_min;
+	packed.position_offset = bounds_min;
+
+	// flat models (e.g. createTriangle) have no size along some axis, and the
+	// scale still has to be invertible
+	for (int axis = 0; axis < 3; axis++) {
+		packed.position_scale[axis] = bounds_size[axis] > 0.0f ? bounds_size[axis] : 1.0f;
+	}
+
+	glm::vec3 inverse_scale = 1.0f / packed.position_scale;
+
+	packed.vertices.resize(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const Vertex& vertex = vertices[i];
+		PackedVertex& packed_vertex = packed.vertices[i];
+
+		glm::vec3 position = (vertex.position - bounds_min) * inverse_scale;
+		// normals transform by the inverse transpose, which for a scale is the
+		// scale itself
+		glm::vec2 normal = encodeOctahedral(vertex.normal * packed.position_scale);
+
+		for (int axis = 0; axis < 3; axis++) {
+			packed_vertex.position[axis] = glm::packUnorm1x16(position[axis]);
+			packed_vertex.color[axis] = glm::packUnorm1x8(vertex.color[axis]);
+		}
+
+		packed_vertex.color[3] = 255;
+		packed_vertex.normal[0] = glm::packSnorm1x8(normal.x);
+		packed_vertex.normal[1] = glm::packSnorm1x8(normal.y);
+		packed_vertex.uv[0] = glm::packHalf1x16(vertex.uv.x);
+		packed_vertex.uv[1] = glm::packHalf1x16(vertex.uv.y);
+	}
+
+	return packed;
+}
+
+const glm::mat4 PackedModel::getDequantizeMatrix() const {
+	return glm::scale(glm::translate(glm::mat4(1.0f), position_offset), position_scale);
+}
+
+const Vertex PackedModel::unpackVertex(const size_t index) const {
+	const PackedVertex& packed_vertex = vertices[index];
+	Vertex vertex;
+
+	glm::vec3 position;
+
+	for (int axis = 0; axis < 3; axis++) {
+		position[axis] = glm::unpackUnorm1x16(packed_vertex.position[axis]);
+		vertex.color[axis] = glm::unpackUnorm1x8(packed_vertex.color[axis]);
+	}
+
+	vertex.position = glm::vec3(getDequantizeMatrix() * glm::vec4(position, 1.0f));
+	glm::vec3 normal = decodeOctahedral(glm::vec2(
+			glm::unpackSnorm1x8(packed_vertex.normal[0]),
+			glm::unpackSnorm1x8(packed_vertex.normal[1])));
+	vertex.normal = glm::normalize(normal / position_scale);
+	vertex.uv = glm::vec2(glm::unpackHalf1x16(packed_vertex.uv[0]), glm::unpackHalf1x16(packed_vertex.uv[1]));
+
+	return vertex;
+}
@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -9,15 +10,79 @@
 using ModelID = uint16_t;
 
 
+// zeroed by default so vertices that should be the same compare equal when
+// welding (see Model::weldVertices)
 struct Vertex {
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec3 color;
-	glm::vec2 uv;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f);
+	glm::vec3 color = glm::vec3(0.0f);
+	glm::vec2 uv = glm::vec2(0.0f);
 };
 
+// 16 bytes instead of Vertex's 44, what actually gets uploaded (see
+// PackedModel), shaders/mesh_packed.vert reads it as a uvec4 and unpacks it
+struct PackedVertex {
+	uint16_t position[3]; // unorm16 across the model's bounds
+	uint8_t normal[2]; // snorm8, octahedral
+	uint8_t color[4]; // unorm8, the last one is unused
+	uint16_t uv[2]; // half floats
+};
+
+static_assert(sizeof(PackedVertex) == 16, "mesh_packed.vert expects 16 byte vertices");
+
+// a model with its vertices packed, ready to upload
+// positions are stored relative to the model's bounds, getDequantizeMatrix()
+// takes them back to model space so the renderer can fold it into the object's
+// model matrix, which saves the shader from doing it
+// normals are stored in that same 0 to 1 space, so the inverse transpose of
+// the folded matrix still takes them to the right place
+struct PackedModel {
+	std::vector<PackedVertex> vertices;
+	std::vector<uint32_t> indices;
+	glm::vec3 position_offset = glm::vec3(0.0f); // the bounds' min corner
+	glm::vec3 position_scale = glm::vec3(1.0f); // the bounds' size, 1 along flat axes
+
+	const glm::mat4 getDequantizeMatrix() const;
+
+	// what the shader ends up with, position in model space, to check precision
+	const Vertex unpackVertex(const size_t index) const;
+};
+
+// an indexed triangle list, every model comes out of the create functions
+// already optimized (see optimize())
 struct Model {
+	// roughly the post transform cache of a current GPU, it's just a target for
+	// optimizeVertexCache(), nothing breaks if the real one is a different size
+	static constexpr size_t kVertexCacheSize = 32;
+
 	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices; // three per triangle
+
+	const size_t getTriangleCount() const {
+		return indices.size() / 3;
+	}
+
+	// for models built as a triangle soup: welds, then reorders for the GPU
+	void optimize();
+
+	// merges vertices that are identical in every attribute
+	void weldVertices();
+	// reorders triangles so vertices get reused while they're still in the
+	// post transform cache (Forsyth's linear speed algorithm), so the vertex
+	// shader runs fewer times
+	void optimizeVertexCache();
+	// reorders vertices into the order the triangles first use them, so fetches
+	// walk through the vertex buffer instead of jumping around it
+	void optimizeVertexFetch();
+
+	// how many times the vertex shader runs per triangle with a FIFO cache of
+	// cache_size vertices, 3 is no reuse at all and 0.5 is about the best a
+	// big regular mesh can get
+	const float getCacheMissRatio(const size_t cache_size = kVertexCacheSize) const;
+
+	// positions end up within about 1/65535 of the model's size, normals within
+	// about a degree, colors within 1/255, uvs to half precision
+	const PackedModel pack() const;
 
 	static Model createTriangle(); // returns a basic rainbow triangle
 	static Model createHexahedron( // build a box
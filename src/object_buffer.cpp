@@ -0,0 +1,87 @@
+#include <object_buffer.h>
+
+#include <util.h>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+
+
+const size_t ObjectBuffer::update(
+		const std::vector<const Entity*>& entities,
+		const std::vector<glm::mat4>& mesh_transforms,
+		JobPool& job_pool) {
+	dirty_ranges.clear();
+	rewritten_count = 0;
+
+	if (!mapped) {
+		return 0;
+	}
+
+	size_t object_count = std::min(entities.size(), capacity);
+
+	if (object_count < entities.size()) {
+		util::logError("object buffer only holds %zu objects, %zu won't be drawn", capacity, entities.size() - capacity);
+	}
+
+	shadows.resize(object_count);
+	is_slot_dirty.resize(object_count);
+
+	// every slot only touches its own shadow, flag, and object, so it doesn't
+	// matter which worker gets it
+	job_pool.parallelFor(object_count, kMinBatchSize, [&](const size_t begin, const size_t end, const int worker_index) {
+		for (size_t i = begin; i < end; i++) {
+			const Entity& entity = *entities[i];
+			const glm::mat4& entity_matrix = entity.getModelMatrix();
+			Shadow& shadow = shadows[i];
+
+			if (shadow.is_valid
+					&& shadow.mesh_id == entity.mesh_id
+					&& shadow.color == entity.color
+					&& shadow.model_matrix == entity_matrix) {
+				is_slot_dirty[i] = false;
+				continue;
+			}
+
+			shadow.model_matrix = entity_matrix;
+			shadow.color = entity.color;
+			shadow.mesh_id = entity.mesh_id;
+			shadow.is_valid = true;
+			is_slot_dirty[i] = true;
+
+			glm::mat4 model_matrix = entity_matrix;
+
+			if (entity.mesh_id < mesh_transforms.size()) {
+				model_matrix = model_matrix * mesh_transforms[entity.mesh_id];
+			}
+
+			glm::mat3 normal_matrix = glm::inverseTranspose(glm::mat3(model_matrix));
+
+			// built on the stack and written in one go, so the mapped memory only
+			// ever sees whole sequential writes
+			ObjectData object;
+			object.model_matrix = model_matrix;
+			object.normal_matrix[0] = glm::vec4(normal_matrix[0], 0.0f);
+			object.normal_matrix[1] = glm::vec4(normal_matrix[1], 0.0f);
+			object.normal_matrix[2] = glm::vec4(normal_matrix[2], 0.0f);
+			object.color = glm::vec4(entity.color, 1.0f);
+			mapped[i] = object;
+		}
+	});
+
+	for (size_t i = 0; i < object_count; i++) {
+		if (!is_slot_dirty[i]) {
+			continue;
+		}
+
+		rewritten_count++;
+
+		if (!dirty_ranges.empty() && dirty_ranges.back().first + dirty_ranges.back().count == i) {
+			dirty_ranges.back().count++;
+		} else {
+			dirty_ranges.push_back(Range{static_cast<uint32_t>(i), 1});
+		}
+	}
+
+	return object_count;
+}
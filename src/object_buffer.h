@@ -0,0 +1,74 @@
+#pragma once
+
+#include <entity.h>
+#include <job_pool.h>
+#include <model.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// one object's entry in the object buffer, has to match Object in mesh.vert
+// and mesh_packed.vert (std140, so a mat3 is three vec4 columns)
+struct ObjectData {
+	glm::mat4 model_matrix;
+	// inverse transpose of the model matrix, so the vertex shader doesn't have
+	// to invert a matrix for every vertex
+	glm::vec4 normal_matrix[3];
+	glm::vec4 color; // w is unused
+};
+
+static_assert(sizeof(ObjectData) == 128, "ObjectData has to match the shaders' std140 layout");
+
+
+// keeps the object buffer up to date: one ObjectData per entity, in the order
+// DrawList::build() collected them (i.e. Scene::getNextEntity() order)
+// writes go straight into the persistently mapped buffer the renderer gives us
+// (VMA_ALLOCATION_CREATE_MAPPED_BIT), split across a JobPool, and only for
+// entities whose transform, color or mesh changed since they were last written
+// a copy of what was written is kept on our side to compare against, since
+// reading back from mapped GPU memory is slow (it's usually write combined)
+struct ObjectBuffer {
+	struct Range {
+		uint32_t first;
+		uint32_t count;
+	};
+
+	// what a slot was last written from
+	struct Shadow {
+		glm::mat4 model_matrix;
+		glm::vec3 color;
+		ModelID mesh_id;
+		bool is_valid = false;
+	};
+
+	// not enough work to be worth waking the workers for below this
+	static constexpr size_t kMinBatchSize = 256;
+
+	ObjectData* mapped = nullptr; // owned by the renderer
+	size_t capacity = 0; // objects that fit in mapped
+
+	std::vector<Shadow> shadows; // per slot
+	std::vector<uint8_t> is_slot_dirty; // last update(), per slot
+	// last update(), in ascending order, for flushing if the memory isn't
+	// host coherent (vmaFlushAllocation)
+	std::vector<Range> dirty_ranges;
+	size_t rewritten_count = 0; // last update()
+
+	// the renderer has to call this again whenever it reallocates the buffer
+	void map(ObjectData* memory, const size_t object_capacity) {
+		mapped = memory;
+		capacity = object_capacity;
+		shadows.clear(); // nothing in there is ours yet
+	}
+
+	// mesh_transforms is per ModelID, and gets folded into each object's model
+	// matrix (e.g. PackedModel::getDequantizeMatrix()), or leave it empty
+	// anything past capacity doesn't get written, returns how many objects did
+	const size_t update(
+			const std::vector<const Entity*>& entities,
+			const std::vector<glm::mat4>& mesh_transforms,
+			JobPool& job_pool);
+};
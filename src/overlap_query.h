@@ -0,0 +1,180 @@
+#pragma once
+
+#include <collision.h>
+#include <entity.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+
+// a shape to collect entities with (see Scene::overlap), e.g. an explosion's
+// blast radius, a melee swing's box or an AI's field of view
+struct OverlapQuery {
+	enum class Shape : uint8_t {
+		sphere,
+		aabb,
+		frustum
+	};
+
+	Shape shape = Shape::sphere;
+	bool include_static = true;
+	bool include_dynamic = true;
+	uint8_t dynamic_layer_mask = SphereCollider::kLayerAll; // dynamic layers to collect
+
+	union Volume {
+		Sphere sphere; // center_start is the center
+		AABB box;
+		Frustum frustum;
+	} volume;
+
+	static OverlapQuery fromSphere(const glm::vec3& center, const float radius) {
+		OverlapQuery query;
+		query.shape = Shape::sphere;
+		query.volume.sphere = Sphere{center, radius};
+		return query;
+	}
+
+	static OverlapQuery fromAABB(const AABB& box) {
+		OverlapQuery query;
+		query.shape = Shape::aabb;
+		query.volume.box = box;
+		return query;
+	}
+
+	static OverlapQuery fromFrustum(const Frustum& frustum) {
+		OverlapQuery query;
+		query.shape = Shape::frustum;
+		query.volume.frustum = frustum;
+		return query;
+	}
+
+	// world space box around the query, false for frustums since theirs is
+	// usually too big to be any use
+	const bool getBounds(AABB& bounds) const {
+		switch (shape) {
+			case Shape::sphere: {
+				glm::vec3 radius_extent(volume.sphere.radius);
+				bounds = AABB{volume.sphere.center_start - radius_extent, volume.sphere.center_start + radius_extent};
+				return true;
+			}
+			case Shape::aabb:
+				bounds = volume.box;
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	const bool overlaps(const AABB& box) const {
+		switch (shape) {
+			case Shape::sphere:
+				return sphereOverlapsAABB(volume.sphere.center_start, volume.sphere.radius, box);
+			case Shape::aabb:
+				return aabbsOverlap(volume.box, box);
+			case Shape::frustum:
+				return frustumOverlapsAABB(volume.frustum, box);
+			default:
+				return false;
+		}
+	}
+
+	const bool overlaps(const Sphere& sphere) const {
+		switch (shape) {
+			case Shape::sphere: {
+				glm::vec3 separation = sphere.center_start - volume.sphere.center_start;
+				float touching_distance = sphere.radius + volume.sphere.radius;
+				return glm::dot(separation, separation) <= touching_distance * touching_distance;
+			}
+			case Shape::aabb:
+				return sphereOverlapsAABB(sphere.center_start, sphere.radius, volume.box);
+			case Shape::frustum:
+				return frustumOverlapsSphere(volume.frustum, sphere.center_start, sphere.radius);
+			default:
+				return false;
+		}
+	}
+};
+
+
+struct OverlapHit {
+	enum class Kind : uint8_t {
+		static_entity,
+		dynamic_entity
+	};
+
+	Kind kind;
+	uint16_t index; // a StaticEntityIndex or a DynamicEntityIndex, going by kind
+};
+
+
+// where a query's hits go, backed by storage the caller owns (an array on the
+// stack is fine), so collecting never allocates
+// anything past capacity is dropped, and is_truncated gets set
+struct OverlapResults {
+	OverlapHit* hits = nullptr;
+	uint32_t capacity = 0;
+	uint32_t count = 0;
+	bool is_truncated = false;
+
+	OverlapResults() = default;
+
+	OverlapResults(OverlapHit* storage, const uint32_t storage_capacity) :
+			hits(storage),
+			capacity(storage_capacity) {}
+
+	template <size_t N>
+	OverlapResults(OverlapHit (&storage)[N]) :
+			hits(storage),
+			capacity(static_cast<uint32_t>(N)) {}
+
+	void clear() {
+		count = 0;
+		is_truncated = false;
+	}
+
+	void add(const OverlapHit::Kind kind, const uint16_t index) {
+		if (count < capacity) {
+			hits[count++] = OverlapHit{kind, index};
+		} else {
+			is_truncated = true;
+		}
+	}
+};
+
+
+// batches are walked through the trees this many queries at a time, one bit of
+// a mask each, so every node is fetched once for the whole chunk
+static constexpr size_t kOverlapChunkSize = 64;
+// that only pays off if the chunk's queries mostly visit the same nodes, so the
+// box around all of them can't be more than this many times the size of the
+// biggest one (per axis)
+static constexpr float kOverlapClusterScale = 4.0f;
+
+// whether a chunk of queries is bunched up enough to walk the trees together
+static bool areQueriesClustered(const OverlapQuery* queries, const size_t count) {
+	AABB chunk_bounds;
+	glm::vec3 largest_size(0.0f);
+
+	for (size_t i = 0; i < count; i++) {
+		AABB bounds;
+
+		if (!queries[i].getBounds(bounds)) {
+			return false;
+		}
+
+		if (i == 0) {
+			chunk_bounds = bounds;
+		} else {
+			chunk_bounds.min_pos = glm::min(chunk_bounds.min_pos, bounds.min_pos);
+			chunk_bounds.max_pos = glm::max(chunk_bounds.max_pos, bounds.max_pos);
+		}
+
+		largest_size = glm::max(largest_size, bounds.max_pos - bounds.min_pos);
+	}
+
+	glm::vec3 chunk_size = chunk_bounds.max_pos - chunk_bounds.min_pos;
+
+	return glm::all(glm::lessThanEqual(chunk_size, largest_size * kOverlapClusterScale));
+}
@@ -0,0 +1,205 @@
+#include <projectile.h>
+
+#include <util.h>
+
+
+// same as Scene::kContactSkin
+static constexpr float kContactSkin = 0.001f;
+
+
+ProjectileSystem::ProjectileSystem() {
+	slots.resize(kMaxProjectiles);
+	free_slots.reserve(kMaxProjectiles);
+	live_slots.reserve(kMaxProjectiles);
+
+	// popped from the back, so the first spawn gets slot 0
+	for (size_t i = kMaxProjectiles; i > 0; i--) {
+		free_slots.push_back(static_cast<ProjectileID>(i - 1));
+	}
+}
+
+
+Projectile* ProjectileSystem::spawn(
+		const ModelID mesh_id,
+		const uint16_t material_id,
+		const glm::vec3& position,
+		const glm::quat& rotation,
+		const float scale,
+		const float radius,
+		const glm::vec3& velocity) {
+	if (free_slots.empty()) {
+		return nullptr;
+	}
+
+	ProjectileID id = free_slots.back();
+	free_slots.pop_back();
+	live_slots.push_back(id);
+
+	Projectile& projectile = slots[id];
+	projectile = Projectile{};
+	projectile.entity = Entity(mesh_id, material_id, position, rotation, scale);
+	projectile.previous_position = position;
+	projectile.radius = radius;
+	projectile.velocity = velocity;
+	projectile.lifetime_remaining = kDefaultLifetimeSec;
+	projectile.bounces_remaining = kDefaultMaxBounces;
+	projectile.is_alive = true;
+
+	return &projectile;
+}
+
+
+// finds the first thing the projectile's sphere hits on its way along path
+// t is a fraction of path
+static bool sweepProjectile(
+		const Projectile& projectile,
+		const glm::vec3& path,
+		const StaticBVH& static_bvh,
+		const std::vector<SphereCollider>& dynamic_colliders,
+		const DynamicTree& dynamic_tree,
+		float& t,
+		glm::vec3& normal) {
+	const glm::vec3& origin = projectile.entity.position;
+	bool did_hit = false;
+	t = 1.0f;
+
+	RayHit static_hit;
+
+	if (static_bvh.closestHit(Ray{origin, path}, static_hit, t, projectile.radius)) {
+		did_hit = true;
+		t = static_hit.t;
+		normal = static_hit.normal;
+	}
+
+	float path_length = glm::length(path);
+	glm::vec3 direction = path / path_length;
+
+	// only the dynamic entities whose boxes touch the whole path grown by our
+	// radius can be hit
+	glm::vec3 path_end = origin + path;
+	glm::vec3 radius_extent(projectile.radius);
+	AABB path_bounds{glm::min(origin, path_end) - radius_extent, glm::max(origin, path_end) + radius_extent};
+
+	dynamic_tree.query(path_bounds, [&](const uint32_t entity_index) {
+		const SphereCollider& other = dynamic_colliders[entity_index];
+
+		if (!(projectile.collision_mask & other.layer)) {
+			return true;
+		}
+
+		const Sphere& other_sphere = other.sphere;
+		float other_radius = projectile.radius + other_sphere.radius;
+		float distance;
+
+		if (raySphere(origin, direction, other_sphere.center_start, other_radius, distance)
+				&& distance < t * path_length) {
+			did_hit = true;
+			t = distance / path_length;
+			normal = util::safeNormalize(origin + direction * distance - other_sphere.center_start);
+		}
+
+		return true;
+	});
+
+	return did_hit;
+}
+
+
+static void reflect(glm::vec3& vec, const glm::vec3& normal, const float springiness) {
+	float into_surface = glm::dot(vec, normal);
+
+	if (into_surface < 0.0f) {
+		vec -= normal * (into_surface * (1.0f + springiness));
+	}
+}
+
+
+void ProjectileSystem::update(
+		const float dt_sec,
+		const glm::vec3& gravity_acceleration,
+		const StaticBVH& static_bvh,
+		const std::vector<SphereCollider>& dynamic_colliders,
+		const DynamicTree& dynamic_tree,
+		JobPool& job_pool,
+		PhysicsStats& stats) {
+	// each projectile only touches itself, so they can go in any order
+	job_pool.parallelFor(
+			live_slots.size(),
+			kMinProjectilesPerBatch,
+			[&](const size_t begin, const size_t end, const int worker_index) {
+				for (size_t i = begin; i < end; i++) {
+					Projectile& projectile = slots[live_slots[i]];
+					Entity& entity = projectile.entity;
+					const glm::vec3& position = entity.position;
+
+					projectile.previous_position = position;
+					projectile.hits_this_tick = 0;
+					projectile.lifetime_remaining -= dt_sec;
+
+					if (projectile.lifetime_remaining <= 0.0f) {
+						projectile.is_alive = false;
+						continue;
+					}
+
+					// exact for constant acceleration, so there's no need for substeps
+					glm::vec3 acceleration = gravity_acceleration * projectile.gravity_scale;
+					glm::vec3 path = projectile.velocity * dt_sec + acceleration * (0.5f * dt_sec * dt_sec);
+					projectile.velocity += acceleration * dt_sec;
+
+					for (int bounce = 0; bounce < kMaxBouncesPerTick; bounce++) {
+						float t;
+						glm::vec3 normal;
+
+						if (util::isVectorZero(path)
+								|| !sweepProjectile(projectile, path, static_bvh, dynamic_colliders, dynamic_tree, t, normal)) {
+							entity.setPosition(position + path);
+							break;
+						}
+
+						projectile.hits_this_tick++;
+						entity.setPosition(position + path * t + normal * kContactSkin);
+
+						if (projectile.bounces_remaining == 0) {
+							projectile.is_alive = false;
+							break;
+						}
+
+						projectile.bounces_remaining--;
+
+						path *= 1.0f - t;
+						reflect(path, normal, projectile.springiness);
+						reflect(projectile.velocity, normal, projectile.springiness);
+					}
+
+					if (projectile.align_to_velocity && projectile.hits_this_tick > 0) {
+						entity.setRotation(util::rotationFromDirection(util::safeNormalize(projectile.velocity)));
+					}
+				}
+			});
+
+	// despawn on this thread, keeping the live list in spawn order
+	size_t live_count = 0;
+
+	for (ProjectileID id : live_slots) {
+		Projectile& projectile = slots[id];
+		stats.projectile_hits += projectile.hits_this_tick;
+
+		if (projectile.is_alive) {
+			live_slots[live_count++] = id;
+		} else {
+			free_slots.push_back(id);
+		}
+	}
+
+	live_slots.resize(live_count);
+	stats.projectiles += live_count;
+}
+
+
+void ProjectileSystem::updateRenderOffsets(const float interpolation_alpha) {
+	for (ProjectileID id : live_slots) {
+		Projectile& projectile = slots[id];
+		projectile.entity.setRenderOffset(
+				(projectile.previous_position - projectile.entity.position) * (1.0f - interpolation_alpha));
+	}
+}
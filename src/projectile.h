@@ -0,0 +1,88 @@
+#pragma once
+
+#include <broadphase.h>
+#include <bvh.h>
+#include <dynamic_tree.h>
+#include <entity.h>
+#include <job_pool.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+using ProjectileID = uint16_t;
+
+// something small and fast that only bounces off things, instead of being a
+// full dynamic entity
+struct Projectile {
+	Entity entity; // what gets drawn, position is the center of the sphere
+	glm::vec3 velocity{0.0f};
+	glm::vec3 previous_position{0.0f}; // as of the start of the last tick
+	float radius = 0.0f;
+	float springiness = 1.0f;
+	float gravity_scale = 0.0f; // 0 flies straight
+	float lifetime_remaining = 0.0f; // seconds
+	uint8_t bounces_remaining = 0; // despawns on the hit after this reaches 0
+	uint8_t collision_mask = SphereCollider::kLayerBody; // dynamic layers this hits
+	uint8_t hits_this_tick = 0;
+	bool align_to_velocity = false; // e.g. beams, which should point where they're going
+	bool is_alive = false;
+
+	Projectile() : entity(0, 0, glm::vec3(0.0f), util::kNoRotation, 1.0f) {}
+};
+
+
+// fixed size pool of projectiles, allocated up front so firing nonstop never
+// allocates or moves anything
+// each tick a projectile sweeps along its (straight, or parabolic if it has
+// gravity) path with ray queries against the static BVH and the dynamic
+// entities near its path (found with the dynamic tree), bouncing off whatever
+// it hits
+struct ProjectileSystem {
+	static constexpr size_t kMaxProjectiles = 1024;
+	static constexpr float kDefaultLifetimeSec = 5.0f;
+	static constexpr uint8_t kDefaultMaxBounces = 8;
+	// bounces handled within one tick, anything after that waits for the next
+	static constexpr int kMaxBouncesPerTick = 4;
+	static constexpr size_t kMinProjectilesPerBatch = 128;
+
+	std::vector<Projectile> slots;
+	std::vector<ProjectileID> free_slots; // used as a stack
+	std::vector<ProjectileID> live_slots; // in the order they were spawned
+
+	ProjectileSystem();
+
+	// returns nullptr if the pool is full
+	// the pointer stays valid until the projectile despawns
+	Projectile* spawn(
+			const ModelID mesh_id,
+			const uint16_t material_id,
+			const glm::vec3& position,
+			const glm::quat& rotation,
+			const float scale,
+			const float radius,
+			const glm::vec3& velocity);
+
+	const size_t liveCount() const {
+		return live_slots.size();
+	}
+
+	const Projectile& getLive(size_t index) const {
+		return slots[live_slots[index]];
+	}
+
+	// moves every projectile, then despawns the ones that ran out of time or bounces
+	void update(
+			const float dt_sec,
+			const glm::vec3& gravity_acceleration,
+			const StaticBVH& static_bvh,
+			const std::vector<SphereCollider>& dynamic_colliders,
+			const DynamicTree& dynamic_tree,
+			JobPool& job_pool,
+			PhysicsStats& stats);
+
+	// see Scene::step
+	void updateRenderOffsets(const float interpolation_alpha);
+};
@@ -1,20 +1,40 @@
 #pragma once
 
+#include <draw_list.h>
+#include <job_pool.h>
 #include <model.h>
+#include <object_buffer.h>
 #include <scene.h>
 #include <window_handler.h>
 
 
+// virtual so a run without a GPU can swap in a NullRenderer (see headless.h)
 struct Renderer {
-	WindowHandler* _window_handler;
+	WindowHandler* _window_handler = nullptr;
+	// upload PackedVertex (see Model::pack) and draw with mesh_packed.vert, with
+	// the model's dequantize matrix folded into each object's model matrix
+	// turn it off to debug with full precision vertices and mesh.vert
+	bool _use_packed_vertices = true;
+	// rebuilt at the start of each draw(), which uploads its instance_objects and
+	// records one instanced draw per batch, so culled entities never reach the GPU
+	mutable DrawList _draw_list;
+	// then brought up to date from the draw list's entities, flushing only its
+	// dirty ranges
+	mutable ObjectBuffer _object_buffer;
 
 	Renderer(WindowHandler* window_handler);
+	virtual ~Renderer() = default;
 
-	const bool init() const;
+	virtual const bool init() const;
 
-	const ModelID uploadModel(const Model model) const;
+	virtual const ModelID uploadModel(const Model model) const;
 
-	void draw(const Scene* const scene) const;
+	// job_pool writes the object buffer, it's the scene's since drawing and
+	// ticking never overlap, so there's no need for a second set of workers
+	virtual void draw(const Scene* const scene, JobPool& job_pool) const;
 
-	void cleanup() const;
+	virtual void cleanup() const;
+
+protected:
+	Renderer() = default; // for renderers that don't need a window
 };
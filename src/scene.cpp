@@ -1,8 +1,18 @@
 #include <scene.h>
 
 
-DynamicEntity& PlayableEntity::getEntity() {
-	return scene->getDynamicEntity(dynamic_ent_id);
+RigidBody& PlayableEntity::getBody() {
+	return scene->dynamic_entities.bodies[scene->getDynamicEntityIndex(dynamic_ent_id)];
+}
+
+
+SphereCollider& PlayableEntity::getCollider() {
+	return scene->dynamic_entities.colliders[scene->getDynamicEntityIndex(dynamic_ent_id)];
+}
+
+
+Entity& PlayableEntity::getRenderEntity() {
+	return scene->dynamic_entities.render_entities[scene->getDynamicEntityIndex(dynamic_ent_id)];
 }
 
 
@@ -17,8 +27,15 @@ Entity& PlayableEntity::getBeamGunEntity() {
 
 
 const glm::vec3 PlayableEntity::eyePosition() const {
-	DynamicEntity& player_ent = scene->getDynamicEntity(dynamic_ent_id);
-	return player_ent.position + eye_offset;
+	const EntityManager& entities = scene->dynamic_entities;
+	return entities.bodies[entities.find(dynamic_ent_id)].position + eye_offset;
+}
+
+
+const glm::vec3 PlayableEntity::spawnPosition(const float projectile_radius) {
+	// start just outside our own collision sphere, so we don't shoot ourselves
+	float offset = getCollider().sphere.radius + projectile_radius + util::kEpsilon;
+	return getBody().position + viewDirection() * offset;
 }
 
 
@@ -30,40 +47,35 @@ void PlayableEntity::shootBall(const float dt_sec) {
 
 	cooldown_remaining = kWeaponCooldownSec / 2;
 
-	DynamicEntity& player_ent = getEntity();
-	DynamicEntity* projectile = scene->addDynamicEntity(
+	constexpr float kProjectileRadius = 0.12f;
+
+	scene->projectiles.spawn(
 			projectile_model_id,
 			0,
-			player_ent.position,
-			player_ent.rotation,
+			spawnPosition(kProjectileRadius),
+			getRenderEntity().rotation,
 			0.2f,
-			0.0f);
-	projectile->initCollision(0.12f);
-	projectile->springiness = 1.0f;
-	projectile->velocity = viewDirection() * 10.0f;
+			kProjectileRadius,
+			viewDirection() * 10.0f);
 }
 
 
 void PlayableEntity::applyForceOnBox(bool is_active) {
 	// reset the pointer
 	Entity& pointer_ent = getPointerEntity();
-	pointer_ent.position = eyePosition();
+	pointer_ent.setPosition(eyePosition());
 
 	if (!is_active) {
 		return;
 	}
 
-	// someday we'll make this box spin
-	Entity& spinny_box = scene->getStaticEntity(0);
-
+	// someday we'll make whatever box we're pointing at spin
 	Ray ray{pointer_ent.position, viewDirection()};
+	RayHit hit;
 
-	glm::vec3 point;
-	float t_min;
-
-	if (rayAABB(ray, spinny_box.collision.shape.box, t_min, point)) {
-		pointer_ent.position = point;
-		pointer_ent.scale = 0.05f;
+	if (scene->raycast(ray, hit)) {
+		pointer_ent.setPosition(hit.point);
+		pointer_ent.setScale(0.05f);
 	}
 }
 
@@ -76,24 +88,20 @@ void PlayableEntity::shootBeam(const float dt_sec) {
 
 	cooldown_remaining = kWeaponCooldownSec / 1.0f;
 
-	DynamicEntity& player_ent = getEntity();
-	DynamicEntity* beam = scene->addDynamicEntity(
+	constexpr float kBeamRadius = 0.12f;
+
+	Projectile* beam = scene->projectiles.spawn(
 			beam_model_id,
 			0,
-			player_ent.position, // eyePosition(),
-			AxisAngle::fromDirection(viewDirection()),
+			spawnPosition(kBeamRadius), // eyePosition(),
+			util::rotationFromDirection(viewDirection()),
 			0.2f,
-			0.0f);
-	beam->initCollision(0.12f);
-	beam->springiness = 1.0f;
-	beam->velocity = viewDirection() * 20.0f;
-
-	beam->setPostAction([](DynamicEntity* self, const float dt_sec) {
-		if (self->didCollide()) {
-			glm::vec3 new_direction = util::safeNormalize(self->velocity);
-			self->rotation = AxisAngle::fromDirection(new_direction);
-		}
-	});
+			kBeamRadius,
+			viewDirection() * 20.0f);
+
+	if (beam) {
+		beam->align_to_velocity = true;
+	}
 }
 
 
@@ -102,7 +110,6 @@ void PlayableEntity::moveFromInputs(
 		const Input::ButtonStates button_states,
 		const Input::MouseState mouse_state) {
 	// apply mouse movement to rotation
-	// I could probably change this to axis angle as well, but it seems tricky
 	view_rotation_euler.x += mouse_state.yOffset; // rotation about x axis
 	view_rotation_euler.y += mouse_state.xOffset; // rotation about y axis
 
@@ -115,6 +122,7 @@ void PlayableEntity::moveFromInputs(
 	float rotationAboutY = -view_rotation_euler.y;
 
 	glm::vec3 new_rotation_euler = glm::vec3(-view_rotation_euler.x, -view_rotation_euler.y, 0.0f);
+	glm::quat y_rotation = glm::angleAxis(new_rotation_euler.y, glm::vec3(0.0f, 1.0f, 0.0f));
 
 	// apply key states to velocity
 	glm::vec3 desired_direction{0.0f};
@@ -133,7 +141,8 @@ void PlayableEntity::moveFromInputs(
 	}
 
 	bool movement_input_detected = (desired_direction != glm::vec3{0.0f});
-	DynamicEntity& ent = getEntity();
+	RigidBody& ent = getBody();
+	const SphereCollider& collider = getCollider();
 	bool is_already_moving = abs(ent.velocity.x) > 0.0f || abs(ent.velocity.z) > 0.0f;
 
 	float max_speed = kMaxWalkSpeed;
@@ -165,14 +174,12 @@ void PlayableEntity::moveFromInputs(
 			// no input, but moving faster than delta_speed -> accel in direction opposite current_direction
 			accel_direction = current_direction * -1.0f;
 
-			if (!ent.isOnGround()) {
+			if (!collider.isOnGround()) {
 				scalar_accel = 0;
 			}
 		} else {
 			// we'll use desired_direction, let's prepare it
-			glm::mat4 y_rotation =
-					glm::rotate(glm::mat4(1.0f), new_rotation_euler.y, glm::vec3(0.0f, 1.0f, 0.0f));
-			desired_direction = glm::vec3(y_rotation * glm::vec4(desired_direction, 0.0f));
+			desired_direction = y_rotation * desired_direction;
 			desired_direction = glm::normalize(desired_direction);
 
 			if (!is_already_moving) {
@@ -202,15 +209,14 @@ void PlayableEntity::moveFromInputs(
 	}
 
 	// jump stuff
-	if (button_states.jump && ent.isOnGround()) {
+	if (button_states.jump && collider.isOnGround()) {
 		constexpr float jump_speed = 0.8f;
 		ent.velocity.y += 8.0f;
 		// util::log("jumping!");
 	}
 
 	// player model should only rotate about the y axis
-	glm::vec3 player_rotation_euler = glm::vec3(0.0f, new_rotation_euler.y, 0.0f);
-	ent.rotation = AxisAngle::fromEulerAngles(player_rotation_euler);
+	getRenderEntity().setRotation(y_rotation);
 
 	// action stuff
 	if (button_states.action) {
@@ -222,8 +228,8 @@ void PlayableEntity::moveFromInputs(
 
 	// move weapon
 	Entity& weapon = getBeamGunEntity();
-	weapon.position = ent.position;
+	weapon.setPosition(ent.position);
 
 	// actually uses x axis rotation as well as y
-	weapon.rotation = AxisAngle::fromEulerAngles(new_rotation_euler);
+	weapon.setRotation(y_rotation * glm::angleAxis(new_rotation_euler.x, glm::vec3(1.0f, 0.0f, 0.0f)));
 }
@@ -1,13 +1,25 @@
 #pragma once
 
+#include <broadphase.h>
+#include <bvh.h>
+#include <dynamic_tree.h>
 #include <entity.h>
+#include <entity_manager.h>
 #include <input.h>
+#include <job_pool.h>
+#include <overlap_query.h>
+#include <projectile.h>
+#include <sweep_and_prune.h>
+#include <triangle_mesh.h>
 #include <util.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <memory>
 #include <vector>
 
 
@@ -37,6 +49,11 @@ struct Camera {
 		view = glm::rotate(view, rotation_euler.y, glm::vec3(0.0f, 1.0f, 0.0f));
 		view = glm::translate(view, adjusted_pos);
 	}
+
+	// for overlap queries (see Scene::overlap)
+	const Frustum getFrustum() const {
+		return Frustum::fromMatrix(projection * view);
+	}
 };
 
 struct Scene;
@@ -70,11 +87,14 @@ struct PlayableEntity {
 					view_rotation_euler(view_rotation_euler),
 					projectile_model_id(projectile_model_id) {}
 
-	DynamicEntity& getEntity();
+	RigidBody& getBody();
+	SphereCollider& getCollider();
+	Entity& getRenderEntity();
 	Entity& getPointerEntity();
 	Entity& getBeamGunEntity();
 
 	const glm::vec3 eyePosition() const;
+	const glm::vec3 spawnPosition(const float projectile_radius); // where our shots start
 
 	void moveFromInputs(
 		const float dt_sec,
@@ -87,99 +107,558 @@ struct PlayableEntity {
 	void shootBeam(const float dt_sec); // like the ball, but it's a beam
 
 	const glm::vec3 viewDirection() const {
-		constexpr glm::vec4 kDefaultView{0.0, 0.0, -1.0f, 0.0f};
-
-		glm::mat4 direction_rotation =
-				glm::rotate(glm::mat4(1.0f), -view_rotation_euler.y, glm::vec3(0.0f, 1.0f, 0.0f));
-		direction_rotation =
-				glm::rotate(direction_rotation, -view_rotation_euler.x, glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::quat view_rotation = util::rotationFromEulerAngles(
+				glm::vec3(-view_rotation_euler.x, -view_rotation_euler.y, 0.0f));
 
-		return glm::vec3(direction_rotation * kDefaultView);
+		return view_rotation * util::neutral_direction;
 	}
 };
 
 
 struct Scene {
-	// TODO: limit the size of the entity arrays to this total value
-	static constexpr int kMaxEntities = 4096;
-
-	std::vector<Entity> static_entities;
-	std::vector<DynamicEntity> dynamic_entities;
+	// static, dynamic and projectile storage together can't go past this
+	static constexpr size_t kMaxEntities = 4096;
+	static constexpr size_t kDefaultMaxStaticEntities = 2048;
+	static constexpr size_t kDefaultMaxDynamicEntities =
+			kMaxEntities - kDefaultMaxStaticEntities - ProjectileSystem::kMaxProjectiles;
+	// max number of static contacts a dynamic entity resolves in one step
+	static constexpr int kMaxCollisionIterations = 4;
+	// gap left between a sphere and whatever it hit, so resting things don't
+	// start every step already touching
+	static constexpr float kContactSkin = 0.001f;
+
+	// the simulation always moves forward in ticks of the same length, no matter
+	// how long frames take
+	static constexpr int kTicksPerSecond = 120;
+	static constexpr float kTickSec = 1.0f / kTicksPerSecond;
+	static constexpr std::chrono::nanoseconds kTickDuration{1000000000 / kTicksPerSecond};
+	// if we fall further behind than this, the simulation slows down instead of
+	// spending even longer catching up
+	static constexpr int kMaxTicksPerStep = 8;
+	// fast entities get split into substeps so they don't travel more than this
+	// many radii at once
+	static constexpr float kMaxSubstepTravelRadii = 1.0f;
+	static constexpr int kMaxSubsteps = 8;
+	// sleeping entities this close together still count as touching, since
+	// resting contacts end up with a small gap
+	static constexpr float kSleepContactMargin = 0.01f;
+
+	// both are allocated up front (see the constructor) and never grow
+	SlotMap<Entity> static_entities;
+	EntityManager dynamic_entities;
 	std::vector<PlayableEntity> playable_entities;
+	ProjectileSystem projectiles;
 
 	Camera camera;
 	int player_entity_index = 0; // only ever one "player" for now
 
-	Scene(Camera cam) : camera(cam) {}
+	std::chrono::nanoseconds tick_accumulator{0}; // frame time not yet simulated
+	uint64_t tick_count = 0;
+	float interpolation_alpha = 0.0f; // how far we are between the last two ticks
+	Input::MouseState pending_mouse_state; // mouse movement not yet used by a tick
+	// turned on while recording or replaying input (see input_recording.h)
+	bool is_checksumming_ticks = false;
+	std::vector<uint64_t> tick_checksums; // stateChecksum() after each tick of the last step
+	bool third_person_cam = false;
+
+	// static collision acceleration, rebuilt whenever static entities are added
+	StaticGrid static_grid;
+	StaticBVH static_bvh; // for ray queries
+	// by static entity slot (StaticEntityID::index), so each mesh lives and dies
+	// with its entity
+	std::vector<std::unique_ptr<TriangleMesh>> collision_meshes;
+	// meshes of removed entities, the static grid and BVH can still point at them
+	// until they're rebuilt
+	std::vector<std::unique_ptr<TriangleMesh>> retired_collision_meshes;
+	bool static_collision_dirty = true;
+	SweepAndPrune dynamic_broadphase;
+	// dynamic entities by where they are, refit at the end of every tick's
+	// physics (see queryDynamicEntities)
+	DynamicTree dynamic_tree;
+	std::vector<DynamicPair> dynamic_pairs;
+	PhysicsStats physics_stats;
+
+	// integration and static collision are split across these, with one
+	// scratch and set of stats per worker
+	JobPool job_pool;
+	std::vector<CollisionScratch> worker_collision_scratch;
+	std::vector<PhysicsStats> worker_physics_stats;
+
+	// islands of touching dynamic entities, rebuilt every tick (union find)
+	std::vector<uint32_t> island_parents;
+	std::vector<uint16_t> island_still_ticks; // the least still member of each island
+
+	Scene(
+			Camera cam,
+			size_t max_static_entities = kDefaultMaxStaticEntities,
+			size_t max_dynamic_entities = kDefaultMaxDynamicEntities) : camera(cam) {
+		size_t max_non_projectiles = kMaxEntities - ProjectileSystem::kMaxProjectiles;
+
+		if (max_static_entities + max_dynamic_entities > max_non_projectiles) {
+			util::logError(
+					"%zu static and %zu dynamic entities is over the limit of %zu, clamping",
+					max_static_entities,
+					max_dynamic_entities,
+					max_non_projectiles);
+
+			max_static_entities = std::min(max_static_entities, max_non_projectiles);
+			max_dynamic_entities = max_non_projectiles - max_static_entities;
+		}
+
+		static_entities.init(max_static_entities);
+		dynamic_entities.init(max_dynamic_entities);
+		collision_meshes.resize(static_entities.capacity());
+	}
 
 	PlayableEntity& getPlayer() {
 		return playable_entities[player_entity_index];
 	}
 
+	// thread_count includes the main thread, 0 means one per core
+	void startWorkers(const int thread_count = 0) {
+		job_pool.start(thread_count);
+	}
+
+	// call once all static entities for a level are in place
+	void buildStaticCollision() {
+		static_grid.build(static_entities.values);
+		static_bvh.build(static_entities.values);
+		static_collision_dirty = false;
+		retired_collision_meshes.clear();
+
+		util::log("using %s collision kernels", simd::getLevelName());
+	}
+
+	// nearest static entity hit by the ray
+	const bool raycast(
+			const Ray& ray,
+			RayHit& hit,
+			float t_max = std::numeric_limits<float>::max()) const {
+		return static_bvh.closestHit(ray, hit, t_max);
+	}
+
+	// whether anything static is hit by the ray, e.g. for line of sight
+	const bool raycastAny(const Ray& ray, float t_max = std::numeric_limits<float>::max()) const {
+		return static_bvh.anyHit(ray, t_max);
+	}
+
+	// raycast for a whole packet of rays at once (weapon fire, line of sight, etc.)
+	void raycastPacket(
+			const RayPacket& rays,
+			RayPacketHits& hits,
+			const float t_max = std::numeric_limits<float>::max()) const {
+		static_bvh.closestHits(rays, hits, t_max);
+	}
+
+	void raycastPacketAny(
+			const RayPacket& rays,
+			RayPacketHits& hits,
+			const float t_max = std::numeric_limits<float>::max()) const {
+		static_bvh.anyHits(rays, hits, t_max);
+	}
+
+	// every dynamic entity that might overlap bounds (as of the end of the last
+	// tick), in no particular order
+	void queryDynamicEntities(const AABB& bounds, std::vector<DynamicEntityIndex>& results) const {
+		results.clear();
+
+		dynamic_tree.query(bounds, [&](const uint32_t entity_index) {
+			if (aabbsOverlap(dynamic_entities.colliders[entity_index].getBounds(), bounds)) {
+				results.push_back(static_cast<DynamicEntityIndex>(entity_index));
+			}
+
+			return true;
+		});
+	}
+
+	// collects every entity overlapping the query into results (cleared first)
+	// static entities come from their collision shapes, so ones without any
+	// collision are never found; dynamic entities are as of the end of the last
+	// tick, and projectiles aren't included
+	void overlap(const OverlapQuery& query, OverlapResults& results) const {
+		overlapBatch(&query, 1, &results);
+	}
+
+	// overlap() for a whole batch, results[i] gets the hits for queries[i]
+	// chunks of queries that are bunched up together (see areQueriesClustered)
+	// walk each tree once for the whole chunk, which measured 0-25% faster than
+	// one at a time ("clustered" in the bench); scattered queries share too few
+	// nodes for that, and measured ~25% slower walked together, so those go one
+	// at a time and cost the same as calling overlap() in a loop
+	void overlapBatch(const OverlapQuery* queries, const size_t query_count, OverlapResults* results) const {
+		for (size_t i = 0; i < query_count; i++) {
+			results[i].clear();
+		}
+
+		for (size_t chunk_start = 0; chunk_start < query_count; chunk_start += kOverlapChunkSize) {
+			size_t chunk_count = std::min(kOverlapChunkSize, query_count - chunk_start);
+			const OverlapQuery* chunk_queries = queries + chunk_start;
+			OverlapResults* chunk_results = results + chunk_start;
+
+			if (areQueriesClustered(chunk_queries, chunk_count)) {
+				static_bvh.collectOverlaps(chunk_queries, chunk_count, chunk_results);
+				dynamic_tree.collectOverlaps(chunk_queries, chunk_count, dynamic_entities.colliders, chunk_results);
+				continue;
+			}
+
+			for (size_t i = 0; i < chunk_count; i++) {
+				static_bvh.collectOverlaps(&chunk_queries[i], 1, &chunk_results[i]);
+				dynamic_tree.collectOverlaps(&chunk_queries[i], 1, dynamic_entities.colliders, &chunk_results[i]);
+			}
+		}
+	}
+
+	// sweeps the entity's sphere from where it was last step to where it moved
+	// to, stopping at the first static contact, bouncing, and carrying on with
+	// whatever is left of the path
+	void collideWithStatic(
+			RigidBody& body,
+			SphereCollider& collider,
+			CollisionScratch& scratch,
+			PhysicsStats& stats) const {
+		Sphere& sphere = collider.sphere;
+		glm::vec3 sphere_center_end = body.position;
+		bool path_is_clear = false;
+
+		for (int i = 0; i < kMaxCollisionIterations && !path_is_clear; i++) {
+			// only look at cells touched by the sphere's path
+			glm::vec3 radius_extent(sphere.radius);
+			AABB path_bounds{
+					glm::min(sphere.center_start, sphere_center_end) - radius_extent,
+					glm::max(sphere.center_start, sphere_center_end) + radius_extent};
+
+			static_grid.query(path_bounds, scratch.grid, scratch.candidates);
+			stats.candidate_pairs += scratch.candidates.size();
+
+			SweepHit earliest_hit;
+			bool did_collide = false;
+
+			auto test_candidate = [&](StaticEntityIndex static_id) {
+				SweepHit hit;
+
+				if (collider.collideWith(static_entities[static_id], sphere_center_end, hit)
+						&& (!did_collide || hit.t < earliest_hit.t)) {
+					did_collide = true;
+					earliest_hit = hit;
+				}
+			};
+
+			// boxes get culled in batches first, using a sphere around the whole path
+			scratch.candidate_boxes.clear();
+			scratch.candidate_box_ids.clear();
+
+			for (StaticEntityIndex static_id : scratch.candidates) {
+				const Collision& other_collision = static_entities[static_id].collision;
+
+				if (other_collision.type == Collision::Type::aabb) {
+					scratch.candidate_boxes.add(other_collision.shape.box);
+					scratch.candidate_box_ids.push_back(static_id);
+				} else {
+					test_candidate(static_id);
+				}
+			}
+
+			if (scratch.hit_indices.size() < scratch.candidate_boxes.count) {
+				scratch.hit_indices.resize(scratch.candidate_boxes.count);
+				scratch.closest_points.resize(scratch.candidate_boxes.count);
+			}
+
+			glm::vec3 path_center = (sphere.center_start + sphere_center_end) * 0.5f;
+			float path_radius = sphere.radius + glm::length(sphere_center_end - sphere.center_start) * 0.5f;
+			size_t box_hit_count = simd::sphereVsAABBs(
+					path_center,
+					path_radius,
+					scratch.candidate_boxes,
+					scratch.hit_indices.data(),
+					scratch.closest_points.data());
+
+			for (size_t hit_index = 0; hit_index < box_hit_count; hit_index++) {
+				test_candidate(scratch.candidate_box_ids[scratch.hit_indices[hit_index]]);
+			}
+
+			if (!did_collide) {
+				path_is_clear = true;
+				break;
+			}
+
+			stats.contacts++;
+
+			glm::vec3 path = sphere_center_end - sphere.center_start;
+			glm::vec3 contact_center =
+					sphere.center_start
+					+ path * earliest_hit.t
+					+ earliest_hit.normal * (earliest_hit.penetration + kContactSkin);
+
+			body.bounceOff(earliest_hit.normal);
+			collider.collisions += earliest_hit.normal;
+
+			// whatever is left of the path bounces the same way the velocity did
+			glm::vec3 remaining_path = path * (1.0f - earliest_hit.t);
+			float into_surface = glm::dot(remaining_path, earliest_hit.normal);
+
+			if (into_surface < 0.0f) {
+				remaining_path -= earliest_hit.normal * (into_surface * (1.0f + body.springiness));
+			}
+
+			sphere.center_start = contact_center;
+			sphere_center_end = contact_center + remaining_path;
+		}
+
+		if (!path_is_clear) {
+			// ran out of iterations, stay at the last place we know is safe
+			sphere_center_end = sphere.center_start;
+		}
+
+		body.position = sphere_center_end;
+		sphere.center_start = sphere_center_end;
+	}
+
+	// enough substeps that the entity moves at most kMaxSubstepTravelRadii of its
+	// own radius per substep
+	const int substepCount(const RigidBody& body, const SphereCollider& collider, const float dt_sec) const {
+		float radius = collider.sphere.radius;
+		float travel = glm::length(body.velocity) * dt_sec;
+
+		if (radius <= 0.0f || travel <= radius * kMaxSubstepTravelRadii) {
+			return 1;
+		}
+
+		float substeps = std::ceil(travel / (radius * kMaxSubstepTravelRadii));
+		return static_cast<int>(std::min(substeps, static_cast<float>(kMaxSubsteps)));
+	}
+
 	// physics works as follows:
 	// move dynamic objects
-	// collide each with static objects
-	// collide with each other
+	// collide each with nearby static objects (found via the static grid)
+	// collide with each other (sweep and prune, then sphere vs sphere)
+	// move projectiles, which bounce off both but don't push anything
+	// the first two only touch the entity itself and static data, so they run in
+	// parallel; the last one runs on this thread in sorted pair order, so the
+	// results are the same no matter how many threads there are
 	void applyPhysics(const float dt_sec) {
 		constexpr glm::vec3 gravity_acceleration{0.0f, -9.8f, 0.0f};
+		// small enough to spread a few hundred projectiles around, big enough that
+		// a handful of entities don't wake anyone up
+		constexpr size_t kMinEntitiesPerBatch = 64;
+
+		if (static_collision_dirty) {
+			buildStaticCollision();
+		}
+
+		physics_stats.reset();
+
+		size_t thread_count = job_pool.threadCount();
+
+		if (worker_collision_scratch.size() != thread_count) {
+			worker_collision_scratch.resize(thread_count);
+			worker_physics_stats.resize(thread_count);
+		}
+
+		for (PhysicsStats& stats : worker_physics_stats) {
+			stats.reset();
+		}
+
+		job_pool.parallelFor(
+				dynamic_entities.size(),
+				kMinEntitiesPerBatch,
+				[&](const size_t begin, const size_t end, const int worker_index) {
+					CollisionScratch& scratch = worker_collision_scratch[worker_index];
+					PhysicsStats& stats = worker_physics_stats[worker_index];
+
+					for (size_t i = begin; i < end; i++) {
+						RigidBody& body = dynamic_entities.bodies[i];
+						SphereCollider& collider = dynamic_entities.colliders[i];
+						SleepState& sleep_state = dynamic_entities.sleep_states[i];
+						dynamic_entities.previous_positions[i] = body.position;
+
+						if (sleep_state.is_asleep) {
+							if (SleepState::isStill(body)) {
+								// collisions are left alone, so we're still on the ground
+								stats.sleeping_entities++;
+								continue;
+							}
+
+							// someone set our velocity directly
+							sleep_state.wake();
+						}
+
+						// reset collisions
+						collider.collisions = glm::vec3(0.0f);
+
+						// based on the speed going in, so the number of substeps doesn't
+						// depend on how anything else got processed
+						int substep_count = substepCount(body, collider, dt_sec);
+						float substep_sec = dt_sec / substep_count;
+
+						for (int substep = 0; substep < substep_count; substep++) {
+							body.applyAcceleration(gravity_acceleration);
+							body.move(substep_sec);
+
+							collideWithStatic(body, collider, scratch, stats);
+						}
+
+						stats.substeps += substep_count;
+					}
+				});
+
+		for (const PhysicsStats& stats : worker_physics_stats) {
+			physics_stats.add(stats);
+		}
+
+		// now against each other, only for pairs whose bounds overlap
+		dynamic_broadphase.update(dynamic_entities.colliders);
+		dynamic_broadphase.findPairs(dynamic_entities.colliders, dynamic_pairs);
+		physics_stats.dynamic_candidate_pairs += dynamic_pairs.size();
 
-		for (auto& entity : dynamic_entities) {
-			// reset collisions
-			entity.collisions = glm::vec3(0.0f);
+		island_parents.resize(dynamic_entities.size());
 
-			entity.applyAcceleration(gravity_acceleration);
-			entity.move(dt_sec);
+		for (uint32_t i = 0; i < island_parents.size(); i++) {
+			island_parents[i] = i;
+		}
 
-			for (auto static_ent : static_entities) {
-				entity.position = entity.collideWith(static_ent, entity.position);
+		for (const DynamicPair& pair : dynamic_pairs) {
+			const std::vector<SleepState>& sleep_states = dynamic_entities.sleep_states;
+			const std::vector<SphereCollider>& colliders = dynamic_entities.colliders;
+
+			if (sleep_states[pair.first].is_asleep && sleep_states[pair.second].is_asleep) {
+				// nothing's moving, just keep track of what's resting on what
+				if (colliders[pair.first].isTouching(colliders[pair.second], kSleepContactMargin)) {
+					joinIslands(pair.first, pair.second);
+				}
+			} else if (dynamic_entities.collidePair(pair.first, pair.second)) {
+				physics_stats.dynamic_contacts++;
+				joinIslands(pair.first, pair.second);
 			}
+		}
+
+		updateSleep();
 
-			// update collision
-			// we're going to want to do this later
-			// represent all dynamic entities as stretched (what's the right word here??)
-			// spheres (the path of movement), then collide with each the environment,
-			// then each other
-			Sphere& sphere = entity.collision.shape.sphere;
-			sphere.center_start = entity.position;
+		dynamic_tree.update(dynamic_entities.colliders, dynamic_entities.bodies, dynamic_entities.previous_positions);
+		physics_stats.dynamic_tree_reinserts += dynamic_tree.reinsert_count;
+
+		projectiles.update(
+				dt_sec,
+				gravity_acceleration,
+				static_bvh,
+				dynamic_entities.colliders,
+				dynamic_tree,
+				job_pool,
+				physics_stats);
+	}
+
+	const uint32_t findIsland(uint32_t index) {
+		while (island_parents[index] != index) {
+			// path halving
+			island_parents[index] = island_parents[island_parents[index]];
+			index = island_parents[index];
 		}
+
+		return index;
 	}
 
+	void joinIslands(const uint32_t first, const uint32_t second) {
+		uint32_t first_root = findIsland(first);
+		uint32_t second_root = findIsland(second);
+
+		// lowest index is always the root, so islands don't depend on pair order
+		if (first_root < second_root) {
+			island_parents[second_root] = first_root;
+		} else if (second_root < first_root) {
+			island_parents[first_root] = second_root;
+		}
+	}
+
+	// an island goes to sleep once everything in it has been still for long
+	// enough, and wakes up as soon as anything in it moves
+	void updateSleep() {
+		for (size_t i = 0; i < dynamic_entities.size(); i++) {
+			SleepState& sleep_state = dynamic_entities.sleep_states[i];
+
+			if (sleep_state.is_asleep) {
+				continue;
+			}
+
+			if (SleepState::isStill(dynamic_entities.bodies[i])) {
+				sleep_state.still_ticks = std::min<int>(sleep_state.still_ticks + 1, SleepState::kTicksBeforeSleep);
+			} else {
+				sleep_state.still_ticks = 0;
+			}
+		}
+
+		island_still_ticks.assign(dynamic_entities.size(), SleepState::kTicksBeforeSleep);
+
+		for (uint32_t i = 0; i < dynamic_entities.size(); i++) {
+			const SleepState& sleep_state = dynamic_entities.sleep_states[i];
+			uint16_t still_ticks = sleep_state.is_asleep ? SleepState::kTicksBeforeSleep : sleep_state.still_ticks;
+			uint16_t& island_still = island_still_ticks[findIsland(i)];
+
+			island_still = std::min(island_still, still_ticks);
+		}
+
+		for (uint32_t i = 0; i < dynamic_entities.size(); i++) {
+			SleepState& sleep_state = dynamic_entities.sleep_states[i];
+			bool island_is_still = island_still_ticks[findIsland(i)] >= SleepState::kTicksBeforeSleep;
+
+			if (island_is_still && !sleep_state.is_asleep) {
+				sleep_state.is_asleep = true;
+				dynamic_entities.bodies[i].velocity = glm::vec3(0.0f);
+			} else if (!island_is_still && sleep_state.is_asleep) {
+				// something we're touching is moving, but we haven't moved ourselves
+				sleep_state.is_asleep = false;
+			}
+		}
+	}
+
+	// runs however many ticks fit in the time since the last step, then sets
+	// things up so the renderer draws them partway to the next tick
 	void step(
 			const std::chrono::microseconds dt,
 			const Input::ButtonStates button_states,
 			const Input::MouseState mouse_state) {
-		PlayableEntity& player = getPlayer();
-		float dt_sec = static_cast<float>(dt.count()) / 1000000;
+		tick_accumulator += dt;
 
-		// limit the amount of time used for physics
-		dt_sec = std::min(dt_sec, 0.02f);
+		pending_mouse_state.xOffset += mouse_state.xOffset;
+		pending_mouse_state.yOffset += mouse_state.yOffset;
 
-		// update velocity, but not position
-		player.moveFromInputs(dt_sec, button_states, mouse_state);
+		int ticks_this_step = 0;
+		tick_checksums.clear();
 
-		applyPhysics(dt_sec);
+		while (tick_accumulator >= kTickDuration) {
+			if (ticks_this_step == kMaxTicksPerStep) {
+				// too far behind, drop the time we couldn't get to
+				tick_accumulator = tick_accumulator % kTickDuration;
+				break;
+			}
 
-		// TODO: fix high speed collision and remove
-		DynamicEntity& player_ent = player.getEntity();
-		if (player_ent.position.y < -40.0f) {
-			// warp to a high-ish point if you go far enough down
-			player_ent.position.y = 10;
-			player_ent.velocity.y = 0.0f; // -420.0f;
-		}
+			// mouse movement only applies once, to whichever tick comes first
+			tick(button_states, pending_mouse_state);
+			pending_mouse_state.reset();
 
-		// do post-step actions
-		for (DynamicEntity& ent : dynamic_entities) {
-			if (ent.has_post_action) {
-				ent.post_action(&ent, dt_sec);
+			if (is_checksumming_ticks) {
+				tick_checksums.push_back(stateChecksum());
 			}
+
+			tick_accumulator -= kTickDuration;
+			ticks_this_step++;
+		}
+
+		if (ticks_this_step > 0 && util::shouldLog()) {
+			physics_stats.log();
 		}
 
-		static bool third_person_cam = false;
+		interpolation_alpha =
+				static_cast<float>(tick_accumulator.count()) / static_cast<float>(kTickDuration.count());
+
+		dynamic_entities.syncRenderEntities(interpolation_alpha);
+
+		projectiles.updateRenderOffsets(interpolation_alpha);
 
 		if (button_states.change_camera) {
 			third_person_cam = !third_person_cam;
 		}
 
+		PlayableEntity& player = getPlayer();
+
 		if (third_person_cam) {
 			glm::vec3 camera_position = Camera::kDefaultPosition;
 			// glm::mat4 rotation =
@@ -189,32 +668,88 @@ struct Scene {
 			// camera.update(player_ent.position + camera_position, player.view_rotation_euler);
 			camera.update(camera_position, Camera::kDefaultRotation);
 		} else {
-			glm::vec3 camera_position = player.eyePosition();
+			glm::vec3 camera_position = player.eyePosition() + player.getRenderEntity().render_offset;
 			camera.update(camera_position, player.view_rotation_euler);
 		}
 	}
 
-	Entity* addStaticEntity(
+	// one fixed length step of the simulation
+	void tick(const Input::ButtonStates button_states, const Input::MouseState mouse_state) {
+		PlayableEntity& player = getPlayer();
+
+		// update velocity, but not position
+		player.moveFromInputs(kTickSec, button_states, mouse_state);
+
+		applyPhysics(kTickSec);
+
+		tick_count++;
+	}
+
+	// covers everything a tick carries over to the next one, so two runs that
+	// are supposed to be identical can be compared tick by tick
+	const uint64_t stateChecksum() const {
+		uint64_t hash = util::hashBytes(&tick_count, sizeof(tick_count));
+
+		// RigidBody is all floats, so there's no padding to trip over
+		hash = util::hashBytes(
+				dynamic_entities.bodies.data(),
+				dynamic_entities.bodies.size() * sizeof(RigidBody),
+				hash);
+
+		for (const SleepState& sleep_state : dynamic_entities.sleep_states) {
+			hash = util::hashBytes(&sleep_state.still_ticks, sizeof(sleep_state.still_ticks), hash);
+			hash = util::hashBytes(&sleep_state.is_asleep, sizeof(sleep_state.is_asleep), hash);
+		}
+
+		for (size_t i = 0; i < projectiles.liveCount(); i++) {
+			const Projectile& projectile = projectiles.getLive(i);
+			hash = util::hashBytes(&projectile.entity.position, sizeof(glm::vec3), hash);
+			hash = util::hashBytes(&projectile.velocity, sizeof(glm::vec3), hash);
+			hash = util::hashBytes(&projectile.bounces_remaining, sizeof(projectile.bounces_remaining), hash);
+		}
+
+		for (const PlayableEntity& playable : playable_entities) {
+			hash = util::hashBytes(&playable.view_rotation_euler, sizeof(glm::vec3), hash);
+			hash = util::hashBytes(&playable.cooldown_remaining, sizeof(float), hash);
+		}
+
+		return hash;
+	}
+
+	// returns an invalid ID if there's no room left
+	StaticEntityID addStaticEntity(
 			const ModelID mesh_id,
 			const uint16_t material_id,
 			glm::vec3 position,
-			AxisAngle rotation,
+			glm::quat rotation,
 			float scale) {
-		static_entities.emplace_back(mesh_id, material_id, position, rotation, scale);
+		StaticEntityID id = static_entities.emplace(mesh_id, material_id, position, rotation, scale);
+
+		if (!id.isValid()) {
+			util::logError("out of room for static entities (%zu)", static_entities.capacity());
+			return id;
+		}
 
-		return &(static_entities.back());
+		static_collision_dirty = true;
+
+		return id;
 	}
 
-	DynamicEntity* addDynamicEntity(
+	// returns an invalid ID if there's no room left
+	DynamicEntityID addDynamicEntity(
 			const ModelID mesh_id,
 			const uint16_t material_id,
 			glm::vec3 position,
-			AxisAngle rotation,
+			glm::quat rotation,
 			float scale,
 			float mass) {
-		dynamic_entities.emplace_back(mesh_id, material_id, position, rotation, scale, mass);
+		DynamicEntityID id = dynamic_entities.add(mesh_id, material_id, position, rotation, scale, mass);
+
+		if (!id.isValid()) {
+			util::logError("out of room for dynamic entities (%zu)", dynamic_entities.capacity());
+		}
 
-		return &(dynamic_entities.back());
+		return id;
 	}
 
 	PlayableEntity* addPlayableEntity(
@@ -226,16 +761,20 @@ struct Scene {
 			float mass,
 			glm::vec3 eye_offset,
 			const ModelID projectile_model_id) {
-		/* DynamicEntity* dynamic_ent = */ addDynamicEntity(
+		DynamicEntityID dynamic_ent_id = addDynamicEntity(
 				mesh_id,
 				material_id,
 				position,
-				AxisAngle::fromEulerAngles(rotation_euler),
+				util::rotationFromEulerAngles(rotation_euler),
 				scale,
 				mass);
 
+		if (!dynamic_ent_id.isValid()) {
+			return nullptr;
+		}
+
 		playable_entities.emplace_back(
-				dynamic_entities.size() - 1,
+				dynamic_ent_id,
 				this,
 				eye_offset,
 				rotation_euler, // view_rotation_euler
@@ -244,12 +783,71 @@ struct Scene {
 		return &(playable_entities.back());
 	}
 
+	// gives a static entity collision that matches a model (e.g. one loaded from
+	// an OBJ file) placed wherever the entity is
+	// calling it again replaces the entity's mesh
+	// returns false if the entity is gone
+	const bool setMeshCollision(StaticEntityID id, const Model& model) {
+		Entity* ent = static_entities.get(id);
+
+		if (!ent) {
+			return false;
+		}
+
+		std::unique_ptr<TriangleMesh>& mesh = collision_meshes[id.index];
+
+		if (!mesh) {
+			mesh = std::make_unique<TriangleMesh>();
+		}
+
+		mesh->build(model, ent->getModelMatrix());
+
+		ent->collision.type = Collision::Type::mesh;
+		ent->collision.shape.mesh = mesh.get();
+		static_collision_dirty = true;
+
+		return true;
+	}
+
+	// returns false if it was already gone
+	// the last static entity takes its place, so the static collision gets rebuilt
+	const bool removeStaticEntity(StaticEntityID id) {
+		if (!static_entities.remove(id)) {
+			return false;
+		}
+
+		if (collision_meshes[id.index]) {
+			retired_collision_meshes.push_back(std::move(collision_meshes[id.index]));
+		}
+
+		static_collision_dirty = true;
+
+		return true;
+	}
+
+	// returns false if it was already gone
+	const bool removeDynamicEntity(DynamicEntityID id) {
+		DynamicEntityIndex removed_index;
+		DynamicEntityIndex moved_from_index;
+
+		if (!dynamic_entities.remove(id, removed_index, moved_from_index)) {
+			return false;
+		}
+
+		dynamic_broadphase.remove(removed_index, moved_from_index);
+		dynamic_tree.remove(removed_index, moved_from_index);
+
+		return true;
+	}
+
+	// these assume the ID is still alive, use static_entities.get() or
+	// dynamic_entities.find() otherwise
 	Entity& getStaticEntity(StaticEntityID id) {
-		return static_entities[id];
+		return *static_entities.get(id);
 	}
 
-	DynamicEntity& getDynamicEntity(DynamicEntityID id) {
-		return dynamic_entities[id];
+	const DynamicEntityIndex getDynamicEntityIndex(DynamicEntityID id) const {
+		return dynamic_entities.find(id);
 	}
 
 	const Entity* getNextEntity(int entity_index) const {
@@ -260,7 +858,13 @@ struct Scene {
 		entity_index -= static_entities.size();
 
 		if (entity_index < dynamic_entities.size()) {
-			return static_cast<const Entity*>(&(dynamic_entities[entity_index]));
+			return &(dynamic_entities.render_entities[entity_index]);
+		}
+
+		entity_index -= dynamic_entities.size();
+
+		if (entity_index < projectiles.liveCount()) {
+			return &(projectiles.getLive(entity_index).entity);
 		}
 
 		return nullptr;
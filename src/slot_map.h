@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+// a reference to something in a SlotMap that knows when it's gone stale: if
+// the thing it pointed to was removed (and maybe replaced), the generation
+// won't match anymore
+// T is only there so handles for different kinds of things can't be mixed up
+// generations are 32 bits so a slot that gets churned through thousands of
+// times a second takes years to come back around to an old handle
+template <typename T>
+struct Handle {
+	static constexpr uint16_t kInvalidIndex = 0xffff;
+
+	uint16_t index = kInvalidIndex; // slot, not position in the dense array
+	uint32_t generation = 0;
+
+	const bool isValid() const {
+		return index != kInvalidIndex;
+	}
+
+	const bool operator==(const Handle& other) const {
+		return index == other.index && generation == other.generation;
+	}
+
+	const bool operator!=(const Handle& other) const {
+		return !(*this == other);
+	}
+};
+
+
+// hands out handles and keeps track of where each one lives in a densely
+// packed array, without owning the array itself (so the storage can be a
+// plain vector, or several of them)
+// everything is sized up front, and removing swaps the last item into the hole
+// freed slots are reused oldest first, so a slot sits out as long as possible
+// before its next generation is handed out
+template <typename T>
+struct SlotAllocator {
+	struct Slot {
+		uint16_t dense_index;
+		uint32_t generation;
+	};
+
+	// a slot whose generation gets this far is retired instead of wrapping to 0
+	static constexpr uint32_t kMaxGeneration = std::numeric_limits<uint32_t>::max();
+
+	std::vector<Slot> slots;
+	std::vector<uint16_t> dense_to_slot;
+	std::vector<uint16_t> free_slots; // ring buffer, freed to the back and allocated from the front
+	size_t free_head = 0;
+	size_t free_count = 0;
+	size_t capacity = 0;
+
+	// capacity has to leave room for Handle::kInvalidIndex
+	void init(const size_t new_capacity) {
+		capacity = new_capacity < Handle<T>::kInvalidIndex ? new_capacity : Handle<T>::kInvalidIndex - 1;
+
+		slots.assign(capacity, Slot{Handle<T>::kInvalidIndex, 0});
+		dense_to_slot.clear();
+		dense_to_slot.reserve(capacity);
+		free_slots.resize(capacity);
+		free_head = 0;
+		free_count = capacity;
+
+		for (size_t i = 0; i < capacity; i++) {
+			free_slots[i] = static_cast<uint16_t>(i);
+		}
+	}
+
+	const size_t size() const {
+		return dense_to_slot.size();
+	}
+
+	// retired slots count against us, so this can happen below capacity
+	const bool isFull() const {
+		return free_count == 0;
+	}
+
+	// the new item goes at the end of the dense array, i.e. at size() - 1
+	// returns an invalid handle if we're full
+	Handle<T> allocate() {
+		if (isFull()) {
+			return Handle<T>{};
+		}
+
+		uint16_t slot_index = free_slots[free_head];
+		free_head = (free_head + 1) % capacity;
+		free_count--;
+
+		Slot& slot = slots[slot_index];
+		slot.dense_index = static_cast<uint16_t>(dense_to_slot.size());
+		dense_to_slot.push_back(slot_index);
+
+		return Handle<T>{slot_index, slot.generation};
+	}
+
+	// position in the dense array, or Handle::kInvalidIndex if the handle is stale
+	const uint16_t find(const Handle<T> handle) const {
+		if (handle.index >= slots.size() || slots[handle.index].generation != handle.generation) {
+			return Handle<T>::kInvalidIndex;
+		}
+
+		return slots[handle.index].dense_index;
+	}
+
+	// the caller has to move the last dense item into out_dense_index (if they
+	// aren't the same), then drop the last one
+	// returns false if the handle is stale
+	const bool free(const Handle<T> handle, uint16_t& out_dense_index) {
+		out_dense_index = find(handle);
+
+		if (out_dense_index == Handle<T>::kInvalidIndex) {
+			return false;
+		}
+
+		uint16_t last_slot_index = dense_to_slot.back();
+		slots[last_slot_index].dense_index = out_dense_index;
+		dense_to_slot[out_dense_index] = last_slot_index;
+		dense_to_slot.pop_back();
+
+		Slot& slot = slots[handle.index];
+		slot.dense_index = Handle<T>::kInvalidIndex;
+		slot.generation++; // every handle to this slot is now stale
+
+		if (slot.generation != kMaxGeneration) {
+			free_slots[(free_head + free_count) % capacity] = handle.index;
+			free_count++;
+		}
+
+		return true;
+	}
+
+	const Handle<T> handleAt(const size_t dense_index) const {
+		uint16_t slot_index = dense_to_slot[dense_index];
+		return Handle<T>{slot_index, slots[slot_index].generation};
+	}
+};
+
+
+// fixed capacity storage addressed by handles, with the values kept densely
+// packed so iterating over them is as fast as a plain vector
+// the values never reallocate, so pointers stay good until something is removed
+template <typename T>
+struct SlotMap {
+	SlotAllocator<T> allocator;
+	std::vector<T> values;
+
+	void init(const size_t capacity) {
+		allocator.init(capacity);
+		values.clear();
+		values.reserve(allocator.capacity);
+	}
+
+	template <typename... Args>
+	Handle<T> emplace(Args&&... args) {
+		Handle<T> handle = allocator.allocate();
+
+		if (handle.isValid()) {
+			values.emplace_back(std::forward<Args>(args)...);
+		}
+
+		return handle;
+	}
+
+	const bool remove(const Handle<T> handle) {
+		uint16_t dense_index;
+
+		if (!allocator.free(handle, dense_index)) {
+			return false;
+		}
+
+		if (dense_index != values.size() - 1) {
+			values[dense_index] = std::move(values.back());
+		}
+
+		values.pop_back();
+
+		return true;
+	}
+
+	// nullptr if the handle is stale
+	T* get(const Handle<T> handle) {
+		uint16_t dense_index = allocator.find(handle);
+		return dense_index == Handle<T>::kInvalidIndex ? nullptr : &values[dense_index];
+	}
+
+	const T* get(const Handle<T> handle) const {
+		uint16_t dense_index = allocator.find(handle);
+		return dense_index == Handle<T>::kInvalidIndex ? nullptr : &values[dense_index];
+	}
+
+	const bool contains(const Handle<T> handle) const {
+		return allocator.find(handle) != Handle<T>::kInvalidIndex;
+	}
+
+	const Handle<T> handleAt(const size_t dense_index) const {
+		return allocator.handleAt(dense_index);
+	}
+
+	const size_t size() const {
+		return values.size();
+	}
+
+	const size_t capacity() const {
+		return allocator.capacity;
+	}
+
+	const bool isFull() const {
+		return allocator.isFull();
+	}
+
+	// dense access, in no particular order
+	T& operator[](const size_t dense_index) {
+		return values[dense_index];
+	}
+
+	const T& operator[](const size_t dense_index) const {
+		return values[dense_index];
+	}
+
+	T& back() {
+		return values.back();
+	}
+
+	typename std::vector<T>::iterator begin() {
+		return values.begin();
+	}
+
+	typename std::vector<T>::iterator end() {
+		return values.end();
+	}
+
+	typename std::vector<T>::const_iterator begin() const {
+		return values.begin();
+	}
+
+	typename std::vector<T>::const_iterator end() const {
+		return values.end();
+	}
+};
@@ -0,0 +1,101 @@
+#include <sweep_and_prune.h>
+
+#include <algorithm>
+
+
+void SweepAndPrune::update(const std::vector<SphereCollider>& colliders) {
+	// new entities always go on the end (removals go through remove()), so
+	// anything past our count is new
+	intervals.reserve(colliders.capacity());
+
+	for (size_t i = intervals.size(); i < colliders.size(); i++) {
+		intervals.push_back({AABB{}, static_cast<DynamicEntityIndex>(i)});
+	}
+
+	for (Interval& interval : intervals) {
+		interval.bounds = colliders[interval.entity_id].getBounds();
+	}
+
+	// insertion sort, cheap when the order barely changed since last frame
+	for (size_t i = 1; i < intervals.size(); i++) {
+		Interval current = intervals[i];
+		size_t j = i;
+
+		while (j > 0 && intervals[j - 1].bounds.min_pos.x > current.bounds.min_pos.x) {
+			intervals[j] = intervals[j - 1];
+			j--;
+		}
+
+		intervals[j] = current;
+	}
+}
+
+
+void SweepAndPrune::remove(const DynamicEntityIndex removed_index, const DynamicEntityIndex moved_from_index) {
+	size_t interval_count = 0;
+	bool had_removed = false;
+	bool had_moved = false;
+
+	// keep the rest in order, so the sort stays cheap
+	for (Interval& interval : intervals) {
+		if (interval.entity_id == removed_index) {
+			had_removed = true;
+			continue;
+		}
+
+		if (interval.entity_id == moved_from_index) {
+			had_moved = true;
+			interval.entity_id = removed_index;
+		}
+
+		intervals[interval_count++] = interval;
+	}
+
+	intervals.resize(interval_count);
+
+	if (had_removed && !had_moved && moved_from_index != removed_index) {
+		// an entity added since the last update moved into a spot we already
+		// track, so it won't be picked up as new
+		intervals.push_back({AABB{}, removed_index});
+	}
+}
+
+
+void SweepAndPrune::findPairs(
+		const std::vector<SphereCollider>& colliders,
+		std::vector<DynamicPair>& pairs) const {
+	pairs.clear();
+
+	for (size_t i = 0; i < intervals.size(); i++) {
+		const Interval& current = intervals[i];
+		const SphereCollider& current_collider = colliders[current.entity_id];
+
+		// walk forward until the next interval starts past the end of this one
+		for (size_t j = i + 1; j < intervals.size(); j++) {
+			const Interval& other = intervals[j];
+
+			if (other.bounds.min_pos.x > current.bounds.max_pos.x) {
+				break;
+			}
+
+			bool overlaps_yz =
+					other.bounds.min_pos.y <= current.bounds.max_pos.y
+					&& other.bounds.max_pos.y >= current.bounds.min_pos.y
+					&& other.bounds.min_pos.z <= current.bounds.max_pos.z
+					&& other.bounds.max_pos.z >= current.bounds.min_pos.z;
+
+			if (!overlaps_yz || !current_collider.canCollideWith(colliders[other.entity_id])) {
+				continue;
+			}
+
+			pairs.push_back({
+					std::min(current.entity_id, other.entity_id),
+					std::max(current.entity_id, other.entity_id)});
+		}
+	}
+
+	// resolve in a fixed order regardless of where things are along the axis
+	std::sort(pairs.begin(), pairs.end(), [](const DynamicPair& a, const DynamicPair& b) {
+		return a.first < b.first || (a.first == b.first && a.second < b.second);
+	});
+}
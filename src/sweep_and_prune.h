@@ -0,0 +1,38 @@
+#pragma once
+
+#include <collision.h>
+#include <entity.h>
+
+#include <vector>
+
+
+struct DynamicPair {
+	DynamicEntityIndex first;
+	DynamicEntityIndex second;
+};
+
+
+// sort and sweep along the x axis for dynamic vs dynamic collisions
+// the interval list is kept sorted between frames; things don't move far in
+// one step, so an insertion sort on mostly sorted data is close to linear
+struct SweepAndPrune {
+	struct Interval {
+		AABB bounds;
+		DynamicEntityIndex entity_id;
+	};
+
+	std::vector<Interval> intervals;
+
+	// pull in new entities and refresh every interval's bounds, then re-sort
+	void update(const std::vector<SphereCollider>& colliders);
+
+	// for when the entity at removed_index is gone, and the one that was at
+	// moved_from_index took its place
+	void remove(const DynamicEntityIndex removed_index, const DynamicEntityIndex moved_from_index);
+
+	// every pair whose bounds overlap on all three axes and whose collision
+	// layers allow them to hit each other, sorted by entity IDs
+	void findPairs(
+			const std::vector<SphereCollider>& colliders,
+			std::vector<DynamicPair>& pairs) const;
+};
@@ -0,0 +1,428 @@
+#include <triangle_mesh.h>
+
+#include <util.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+const AABB getTriangleMeshBounds(const TriangleMesh& mesh) {
+	return mesh.getBounds();
+}
+
+const bool sweptSphereVsTriangleMesh(
+		const Sphere& sphere,
+		const glm::vec3& sphere_center_end,
+		const TriangleMesh& mesh,
+		SweepHit& hit) {
+	return mesh.sweptSphere(sphere, sphere_center_end, hit);
+}
+
+
+void TriangleMesh::build(const Model& model, const glm::mat4& transform) {
+	nodes.clear();
+	triangles.clear();
+
+	size_t triangle_count = model.getTriangleCount();
+	const std::vector<Vertex>& vertices = model.vertices;
+	const std::vector<uint32_t>& indices = model.indices;
+	std::vector<MeshTriangle> unsorted_triangles;
+	std::vector<BVHBuildPrimitive> primitives;
+	unsorted_triangles.reserve(triangle_count);
+	primitives.reserve(triangle_count);
+
+	for (size_t i = 0; i < triangle_count; i++) {
+		MeshTriangle triangle;
+		triangle.a = glm::vec3(transform * glm::vec4(vertices[indices[3 * i + 0]].position, 1.0f));
+		triangle.b = glm::vec3(transform * glm::vec4(vertices[indices[3 * i + 1]].position, 1.0f));
+		triangle.c = glm::vec3(transform * glm::vec4(vertices[indices[3 * i + 2]].position, 1.0f));
+
+		glm::vec3 normal = glm::cross(triangle.b - triangle.a, triangle.c - triangle.a);
+		float double_area = glm::length(normal);
+
+		if (double_area < util::kEpsilon * util::kEpsilon) {
+			continue;
+		}
+
+		triangle.normal = normal / double_area;
+
+		AABB box{
+				glm::min(triangle.a, glm::min(triangle.b, triangle.c)),
+				glm::max(triangle.a, glm::max(triangle.b, triangle.c))};
+		primitives.push_back({box, (box.min_pos + box.max_pos) * 0.5f, static_cast<uint32_t>(unsorted_triangles.size())});
+		unsorted_triangles.push_back(triangle);
+	}
+
+	buildBVH(primitives, kMaxLeafSize, nodes);
+
+	triangles.reserve(primitives.size());
+
+	for (const BVHBuildPrimitive& prim : primitives) {
+		triangles.push_back(unsorted_triangles[prim.id]);
+	}
+
+	util::log(
+			"built triangle mesh: %zu triangles (%zu dropped), %zu nodes",
+			triangles.size(),
+			triangle_count - triangles.size(),
+			nodes.size());
+}
+
+
+// real time collision detection pg. 141
+static glm::vec3 closestPointOnTriangle(const glm::vec3& point, const MeshTriangle& triangle) {
+	const glm::vec3& a = triangle.a;
+	const glm::vec3& b = triangle.b;
+	const glm::vec3& c = triangle.c;
+
+	glm::vec3 ab = b - a;
+	glm::vec3 ac = c - a;
+	glm::vec3 ap = point - a;
+	float d1 = glm::dot(ab, ap);
+	float d2 = glm::dot(ac, ap);
+
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		return a; // vertex region a
+	}
+
+	glm::vec3 bp = point - b;
+	float d3 = glm::dot(ab, bp);
+	float d4 = glm::dot(ac, bp);
+
+	if (d3 >= 0.0f && d4 <= d3) {
+		return b; // vertex region b
+	}
+
+	float vc = d1 * d4 - d3 * d2;
+
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return a + ab * (d1 / (d1 - d3)); // edge region ab
+	}
+
+	glm::vec3 cp = point - c;
+	float d5 = glm::dot(ab, cp);
+	float d6 = glm::dot(ac, cp);
+
+	if (d6 >= 0.0f && d5 <= d6) {
+		return c; // vertex region c
+	}
+
+	float vb = d5 * d2 - d1 * d6;
+
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return a + ac * (d2 / (d2 - d6)); // edge region ac
+	}
+
+	float va = d3 * d6 - d5 * d4;
+
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))); // edge region bc
+	}
+
+	// face region
+	float denominator = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+
+// point is assumed to be on the triangle's plane
+static bool isPointInTriangle(const glm::vec3& point, const MeshTriangle& triangle) {
+	return glm::dot(glm::cross(triangle.b - triangle.a, point - triangle.a), triangle.normal) >= 0.0f
+			&& glm::dot(glm::cross(triangle.c - triangle.b, point - triangle.b), triangle.normal) >= 0.0f
+			&& glm::dot(glm::cross(triangle.a - triangle.c, point - triangle.c), triangle.normal) >= 0.0f;
+}
+
+
+// sweeps a sphere that isn't already touching the triangle along a normalized
+// direction, finding how far it gets before it does
+// the face is tried first; if the sphere misses it (or starts out level with
+// the plane), the edges get tested as capsules, which also covers the corners
+static bool sweepSphereVsTriangle(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float max_distance,
+		const float radius,
+		const MeshTriangle& triangle,
+		float& distance,
+		glm::vec3& normal) {
+	glm::vec3 face_normal = triangle.normal;
+	float start_height = glm::dot(origin - triangle.a, face_normal);
+
+	// two sided, so use whichever side we're on
+	if (start_height < 0.0f) {
+		face_normal = -face_normal;
+		start_height = -start_height;
+	}
+
+	float approach_speed = -glm::dot(direction, face_normal);
+
+	if (start_height >= radius) {
+		if (approach_speed <= 0.0f) {
+			// never gets close enough to the plane
+			return false;
+		}
+
+		float plane_distance = (start_height - radius) / approach_speed;
+
+		if (plane_distance > max_distance) {
+			return false;
+		}
+
+		glm::vec3 plane_contact = origin + direction * plane_distance - face_normal * radius;
+
+		if (isPointInTriangle(plane_contact, triangle)) {
+			distance = plane_distance;
+			normal = face_normal;
+			return true;
+		}
+	}
+
+	if (radius <= 0.0f) {
+		return false;
+	}
+
+	const glm::vec3* corners[3] = {&triangle.a, &triangle.b, &triangle.c};
+	bool did_hit = false;
+	float nearest = max_distance;
+	int nearest_edge = 0;
+
+	for (int edge = 0; edge < 3; edge++) {
+		float edge_distance;
+
+		if (rayCapsule(origin, direction, *corners[edge], *corners[(edge + 1) % 3], radius, edge_distance)
+				&& edge_distance <= nearest) {
+			did_hit = true;
+			nearest = edge_distance;
+			nearest_edge = edge;
+		}
+	}
+
+	if (!did_hit) {
+		return false;
+	}
+
+	// push away from the closest point on the edge that was hit
+	const glm::vec3& edge_start = *corners[nearest_edge];
+	glm::vec3 edge = *corners[(nearest_edge + 1) % 3] - edge_start;
+	glm::vec3 contact_center = origin + direction * nearest;
+	float along_edge = std::clamp(glm::dot(contact_center - edge_start, edge) / glm::dot(edge, edge), 0.0f, 1.0f);
+
+	distance = nearest;
+	normal = util::safeNormalize(contact_center - (edge_start + edge * along_edge));
+
+	if (util::isVectorZero(normal)) {
+		normal = face_normal;
+	}
+
+	return true;
+}
+
+
+static bool doBoxesOverlap(const AABB& a, const glm::vec3& b_min, const glm::vec3& b_max) {
+	return glm::all(glm::lessThanEqual(a.min_pos, b_max)) && glm::all(glm::lessThanEqual(b_min, a.max_pos));
+}
+
+
+const bool TriangleMesh::sweptSphere(const Sphere& sphere, const glm::vec3& sphere_center_end, SweepHit& hit) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	const glm::vec3& start = sphere.center_start;
+	float squared_radius = sphere.radius * sphere.radius;
+
+	glm::vec3 path = sphere_center_end - start;
+	float path_length = glm::length(path);
+	bool is_moving = path_length >= util::kEpsilon;
+	glm::vec3 direction = is_moving ? path / path_length : glm::vec3(0.0f);
+
+	glm::vec3 radius_extent(sphere.radius);
+	AABB path_bounds{
+			glm::min(start, sphere_center_end) - radius_extent,
+			glm::max(start, sphere_center_end) + radius_extent};
+
+	bool is_overlapping = false;
+	float deepest_penetration = 0.0f;
+	glm::vec3 overlap_normal{0.0f};
+
+	bool did_hit = false;
+	float nearest = path_length;
+	glm::vec3 hit_normal{0.0f};
+
+	uint32_t stack[kBVHMaxDepth + 1];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		const BVHNode& node = nodes[stack[--stack_size]];
+
+		if (!doBoxesOverlap(path_bounds, node.min_pos, node.max_pos)) {
+			continue;
+		}
+
+		if (!node.isLeaf()) {
+			stack[stack_size++] = node.offset;
+			stack[stack_size++] = static_cast<uint32_t>(&node - nodes.data()) + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.offset; i < node.offset + node.primitive_count; i++) {
+			const MeshTriangle& triangle = triangles[i];
+			float start_height = glm::dot(start - triangle.a, triangle.normal);
+			bool is_near_plane = std::abs(start_height) < sphere.radius;
+			glm::vec3 closest_to_start;
+			float squared_distance = squared_radius;
+
+			// the plane is a cheap way to rule out most overlaps
+			if (is_near_plane) {
+				closest_to_start = start - closestPointOnTriangle(start, triangle);
+				squared_distance = glm::dot(closest_to_start, closest_to_start);
+			}
+
+			if (squared_distance < squared_radius) {
+				float distance = std::sqrt(squared_distance);
+				float penetration = sphere.radius - distance;
+
+				if (!is_overlapping || penetration > deepest_penetration) {
+					is_overlapping = true;
+					deepest_penetration = penetration;
+
+					if (distance > util::kEpsilon) {
+						overlap_normal = closest_to_start / distance;
+					} else {
+						// center is right on the triangle, back out the way we came
+						overlap_normal = glm::dot(triangle.normal, direction) > 0.0f ? -triangle.normal : triangle.normal;
+					}
+				}
+			} else if (!is_overlapping && is_moving) {
+				float distance;
+				glm::vec3 normal;
+
+				if (sweepSphereVsTriangle(start, direction, nearest, sphere.radius, triangle, distance, normal)) {
+					did_hit = true;
+					nearest = distance;
+					hit_normal = normal;
+				}
+			}
+		}
+	}
+
+	if (is_overlapping) {
+		hit.t = 0.0f;
+		hit.normal = overlap_normal;
+		hit.penetration = deepest_penetration;
+		return true;
+	}
+
+	if (did_hit) {
+		hit.t = nearest / path_length;
+		hit.normal = hit_normal;
+		hit.penetration = 0.0f;
+		return true;
+	}
+
+	return false;
+}
+
+
+const bool TriangleMesh::closestHit(const Ray& ray, float& t_max, glm::vec3& normal, const float radius) const {
+	float direction_length = glm::length(ray.direction);
+
+	if (nodes.empty() || direction_length < util::kEpsilon) {
+		return false;
+	}
+
+	// triangle tests want a normalized direction, t is in terms of ray.direction
+	glm::vec3 unit_direction = ray.direction / direction_length;
+	RayInverse ray_inverse = RayInverse::fromRay(ray);
+	glm::vec3 radius_extent(radius);
+	bool found_hit = false;
+
+	uint32_t stack[kBVHMaxDepth + 1];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		const BVHNode& node = nodes[stack[--stack_size]];
+		float t_enter;
+
+		AABB node_box{node.min_pos - radius_extent, node.max_pos + radius_extent};
+
+		if (!rayAABBInverse(ray_inverse, node_box, t_max, t_enter)) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (uint32_t i = node.offset; i < node.offset + node.primitive_count; i++) {
+				float distance;
+				glm::vec3 triangle_normal;
+
+				if (sweepSphereVsTriangle(
+						ray.origin,
+						unit_direction,
+						t_max * direction_length,
+						radius,
+						triangles[i],
+						distance,
+						triangle_normal)) {
+					found_hit = true;
+					t_max = distance / direction_length;
+					normal = triangle_normal;
+				}
+			}
+		} else {
+			uint32_t near_child = static_cast<uint32_t>(&node - nodes.data()) + 1;
+			uint32_t far_child = node.offset;
+
+			if (ray.direction[node.split_axis] < 0.0f) {
+				std::swap(near_child, far_child);
+			}
+
+			stack[stack_size++] = far_child;
+			stack[stack_size++] = near_child;
+		}
+	}
+
+	return found_hit;
+}
+
+
+const bool TriangleMesh::anyHit(const Ray& ray, const float t_max) const {
+	float direction_length = glm::length(ray.direction);
+
+	if (nodes.empty() || direction_length < util::kEpsilon) {
+		return false;
+	}
+
+	glm::vec3 unit_direction = ray.direction / direction_length;
+	RayInverse ray_inverse = RayInverse::fromRay(ray);
+
+	uint32_t stack[kBVHMaxDepth + 1];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0) {
+		const BVHNode& node = nodes[stack[--stack_size]];
+		float t_enter;
+
+		if (!rayAABBInverse(ray_inverse, AABB{node.min_pos, node.max_pos}, t_max, t_enter)) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (uint32_t i = node.offset; i < node.offset + node.primitive_count; i++) {
+				float distance;
+				glm::vec3 normal;
+
+				if (sweepSphereVsTriangle(ray.origin, unit_direction, t_max * direction_length, 0.0f, triangles[i], distance, normal)) {
+					return true;
+				}
+			}
+		} else {
+			stack[stack_size++] = node.offset;
+			stack[stack_size++] = static_cast<uint32_t>(&node - nodes.data()) + 1;
+		}
+	}
+
+	return false;
+}
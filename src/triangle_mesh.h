@@ -0,0 +1,55 @@
+#pragma once
+
+#include <bvh.h>
+#include <collision.h>
+#include <model.h>
+
+#include <glm/glm.hpp>
+
+#include <limits>
+#include <vector>
+
+
+struct MeshTriangle { // 48 bytes
+	glm::vec3 a;
+	glm::vec3 b;
+	glm::vec3 c;
+	glm::vec3 normal; // unit length, follows the winding order
+};
+
+
+// static collision for arbitrary geometry (e.g. a building loaded from an OBJ
+// file), stored as world space triangles with their own BVH
+// sweeps only run sphere vs triangle on the leaves their path overlaps, so a
+// few thousand triangles end up costing about as much as a handful of boxes
+// triangles are two sided, since plenty of models aren't closed
+struct TriangleMesh {
+	static constexpr int kMaxLeafSize = 4;
+
+	std::vector<BVHNode> nodes;
+	std::vector<MeshTriangle> triangles; // reordered so each leaf is a contiguous range
+
+	// takes a model's triangles, transform takes them to world space
+	// degenerate triangles are dropped
+	void build(const Model& model, const glm::mat4& transform);
+
+	const AABB getBounds() const {
+		if (nodes.empty()) {
+			return AABB{glm::vec3(0.0f), glm::vec3(0.0f)};
+		}
+
+		return AABB{nodes[0].min_pos, nodes[0].max_pos};
+	}
+
+	// same idea as Collision::sweptSphereVsAABB: if the sphere already overlaps
+	// the mesh, this gives the deepest penetration, otherwise the first contact
+	// along the path
+	const bool sweptSphere(const Sphere& sphere, const glm::vec3& sphere_center_end, SweepHit& hit) const;
+
+	// nearest hit along the ray within [0, t_max], which shrinks to the hit
+	// a radius sweeps a sphere along the ray instead (see StaticBVH::closestHit)
+	const bool closestHit(const Ray& ray, float& t_max, glm::vec3& normal, const float radius = 0.0f) const;
+
+	// stops at the first hit found within [0, t_max]
+	const bool anyHit(const Ray& ray, const float t_max) const;
+};
@@ -8,6 +8,10 @@
 #include <iostream>
 #include <random>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 
 void util::log(const char* fmt, ...) {
 	va_list args;
@@ -131,8 +135,8 @@ void util::logMat4(const glm::mat4& mat, const char* fmt, ...) {
 	printf("    %f, %f, %f, %f\n", mat[3].x, mat[3].y, mat[3].y, mat[3].w);
 }
 
-void util::logAxisAngle(const AxisAngle& aa) {
-	logVec3(aa.axis, "angle: %f, axis: ", aa.angle);
+void util::logQuat(const glm::quat& quat) {
+	util::log("quat: %f, %f, %f, %f (w, x, y, z)", quat.w, quat.x, quat.y, quat.z);
 }
 
 const float util::getElapsedTime() {
@@ -144,6 +148,37 @@ const float util::getElapsedTime() {
 			currentTime - startTime).count();
 }
 
+const int util::countTrailingZeros(const uint32_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
+const int util::countTrailingZeros64(const uint64_t value) {
+	uint32_t low = static_cast<uint32_t>(value);
+
+	if (low != 0) {
+		return countTrailingZeros(low);
+	}
+
+	return 32 + countTrailingZeros(static_cast<uint32_t>(value >> 32));
+}
+
+const uint64_t util::hashBytes(const void* data, const size_t size, uint64_t hash) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
+
 const bool util::areVectorsEqual(const glm::vec3& v1, const glm::vec3& v2) {
 	return glm::all(glm::epsilonEqual(v1, v2, kEpsilon));
 }
@@ -156,29 +191,22 @@ glm::vec3 util::safeNormalize(const glm::vec3& vec) {
 	return isVectorZero(vec) ? vec : glm::normalize(vec);
 }
 
-AxisAngle AxisAngle::fromDirection(const glm::vec3& new_direction) {
-	AxisAngle result;
-	result.axis = util::safeNormalize(glm::cross(util::neutral_direction, new_direction));
-	result.angle = acos(glm::dot(util::neutral_direction, new_direction));
-	return result;
-}
+glm::quat util::rotationFromDirection(const glm::vec3& new_direction) {
+	float cos_angle = glm::dot(neutral_direction, new_direction);
 
-AxisAngle AxisAngle::fromEulerAngles(const glm::vec3& euler_angles) {
-	glm::mat4 rotation_matrix = glm::rotate(
-			glm::rotate(
-					glm::rotate(
-							glm::mat4(1.0f),
-							euler_angles.y,
-							glm::vec3(0.0f, 1.0f, 0.0f)),
-					euler_angles.x,
-					glm::vec3(1.0f, 0.0f, 0.0f)),
-			euler_angles.z,
-			glm::vec3(0.0f, 0.0f, 1.0f));
+	if (cos_angle < kEpsilon - 1.0f) {
+		// facing the opposite way, so the cross product is useless, but any
+		// perpendicular axis works
+		return glm::angleAxis(glm::pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+	}
 
-	glm::vec3 new_direction = glm::vec3(rotation_matrix * glm::vec4(util::neutral_direction, 0.0f));
-	return AxisAngle::fromDirection(new_direction);
+	// halfway between the two directions, which avoids needing acos
+	glm::vec3 axis = glm::cross(neutral_direction, new_direction);
+	return glm::normalize(glm::quat(1.0f + cos_angle, axis.x, axis.y, axis.z));
 }
 
-void AxisAngle::log() {
-	util::logAxisAngle(*this);
+glm::quat util::rotationFromEulerAngles(const glm::vec3& euler_angles) {
+	return glm::angleAxis(euler_angles.y, glm::vec3(0.0f, 1.0f, 0.0f))
+			* glm::angleAxis(euler_angles.x, glm::vec3(1.0f, 0.0f, 0.0f))
+			* glm::angleAxis(euler_angles.z, glm::vec3(0.0f, 0.0f, 1.0f));
 }
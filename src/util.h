@@ -1,19 +1,10 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <chrono>
-
-
-struct AxisAngle {
-	glm::vec3 axis;
-	float angle;
-
-	static AxisAngle fromDirection(const glm::vec3& new_direction);
-	static AxisAngle fromEulerAngles(const glm::vec3& euler_angles);
-
-	void log();
-};
+#include <cstdint>
 
 
 namespace util {
@@ -30,7 +21,7 @@ namespace util {
 
 	void logVec3(const glm::vec3& vec, const char* fmt = "", ...);
 	void logMat4(const glm::mat4& mat, const char* fmt = "", ...);
-	void logAxisAngle(const AxisAngle& aa);
+	void logQuat(const glm::quat& quat);
 
 	const float getElapsedTime();
 
@@ -39,6 +30,20 @@ namespace util {
 	// by default, everythiing starts off staring down the Z axis in the negative
 	// direction (i.e. into the screen, if the player is also facing this direction)
 	constexpr glm::vec3 neutral_direction{0.0f, 0.0f, -1.0f};
+	constexpr glm::quat kNoRotation{1.0f, 0.0f, 0.0f, 0.0f};
+
+	// turns neutral_direction to face new_direction (which should be normalized)
+	glm::quat rotationFromDirection(const glm::vec3& new_direction);
+	// about y, then x, then z, i.e. yaw, pitch, roll
+	glm::quat rotationFromEulerAngles(const glm::vec3& euler_angles);
+
+	// index of the lowest set bit, value must not be 0
+	const int countTrailingZeros(const uint32_t value);
+	const int countTrailingZeros64(const uint64_t value);
+
+	// FNV-1a, pass the last result back in as hash to keep adding to it
+	constexpr uint64_t kHashSeed = 0xcbf29ce484222325;
+	const uint64_t hashBytes(const void* data, const size_t size, uint64_t hash = kHashSeed);
 
 	const bool areVectorsEqual(const glm::vec3& v1, const glm::vec3& v2);
 	const bool isVectorZero(const glm::vec3& vec);
@@ -12,6 +12,8 @@ constexpr int kDefaultWindowHeight = 600;
 
 
 // wraps SDL or GLFW to handle window, surface, and input
+// handleInput and cleanup are virtual so input can come from somewhere other
+// than a window (see headless.h)
 struct WindowHandler {
 	int _window_width = kDefaultWindowWidth;
 	int _window_height = kDefaultWindowHeight;
@@ -22,7 +24,8 @@ struct WindowHandler {
 	Input::MouseState _mouse_state;
 
 	WindowHandler(int width, int height);
-	void cleanup();
+	virtual ~WindowHandler() = default;
+	virtual void cleanup();
 
 	const bool isRunning() const {
 		return _is_running;
@@ -32,7 +35,10 @@ struct WindowHandler {
 
 	const bool createSurface(VkInstance instance, VkSurfaceKHR* surface) const;
 
-	void handleInput();
+	virtual void handleInput();
 	const Input::ButtonStates getButtonStates() const;
 	const Input::MouseState getMouseState() const;
+
+protected:
+	WindowHandler() = default; // no window gets created
 };